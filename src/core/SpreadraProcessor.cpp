@@ -1,6 +1,7 @@
 #include "SpreadraProcessor.h"
 #include "../gui/SpreadraEditor.h"
  #include <algorithm>
+#include <cstring>
 
 //==============================================================================
 SpreadraProcessor::SpreadraProcessor()
@@ -13,12 +14,18 @@ SpreadraProcessor::SpreadraProcessor()
     Logger::getInstance().initialize("Spreadra");
     SHIMMER_LOG_INFO("SpreadraProcessor initialized");
     
+    dryWetValue = parameters.getRawParameterValue("dryWet");
+    stereoWidthValue = parameters.getRawParameterValue("stereoWidth");
+    
     // Инициализация параметров
     updateParameters();
+    startTimerHz(parameterUpdateHz);
 }
 
 SpreadraProcessor::~SpreadraProcessor()
 {
+    stopTimer();
+    
     // SHIMMER_LOG_INFO("SpreadraProcessor shutting down");
     // Logger::getInstance().shutdown();
 }
@@ -29,11 +36,12 @@ void SpreadraProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
     // SHIMMER_LOG_INFO("Preparing to play: sampleRate=" + juce::String(sampleRate) + 
     //                  ", samplesPerBlock=" + juce::String(samplesPerBlock));
     
+    // Повторный вызов с той же частотой сохраняет хвост и не перевыделяет буферы
     reverbAlgorithm.prepare(sampleRate, samplesPerBlock);
-    tempBuffer.setSize(getTotalNumOutputChannels(), samplesPerBlock);
+    tempBuffer.setSize(getTotalNumOutputChannels(), samplesPerBlock, false, false, true);
     
-    // Обновление метрик
-    latencyMs = reverbAlgorithm.getLatency();
+    // Задержка для компенсации хостом: ноль, кроме равномерной свертки
+    updateLatency();
     
     // SHIMMER_LOG_INFO("Spreadra ready: latency=" + juce::String(latencyMs, 2) + "ms");
 }
@@ -69,20 +77,32 @@ void SpreadraProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::Mid
     for (int i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear(i, 0, numSamples);
     
-    // Обновление параметров если изменились
-    updateParameters();
+    // Dry/wet - только атомарная запись; ширину (снимок движка) передает таймер
+    reverbAlgorithm.setDryWet(dryWetValue->load(std::memory_order_relaxed));
     
-    // УПРОЩЕНО: всегда используем стерео обработку
     const float* inputL = buffer.getReadPointer(0);
-    const float* inputR = (totalNumInputChannels > 1) ? buffer.getReadPointer(1) : inputL; // Дублируем L если моно
-    
     float* outputL = buffer.getWritePointer(0);
-    float* outputR = (totalNumOutputChannels > 1) ? buffer.getWritePointer(1) : outputL; // Используем L если моно выход
     
-    reverbAlgorithm.processStereo(inputL, inputR, outputL, outputR, numSamples);
+    // Моно выход: считаем только один канал сети
+    if (totalNumOutputChannels < 2)
+    {
+        reverbAlgorithm.process(inputL, outputL, numSamples);
+    }
+    else
+    {
+        const float* inputR = (totalNumInputChannels > 1) ? buffer.getReadPointer(1) : inputL; // Дублируем L если моно
+        float* outputR = buffer.getWritePointer(1);
+        
+        // Dual mono: побитово одинаковые L и R подаем одним буфером - без лишней копии и даунмикса
+        if (inputR != inputL && std::memcmp(inputL, inputR, sizeof(float) * static_cast<size_t>(numSamples)) == 0)
+            inputR = inputL;
+        
+        reverbAlgorithm.processStereo(inputL, inputR, outputL, outputR, numSamples);
+    }
     
     // Обновление метрик производительности
     cpuUsage = reverbAlgorithm.getCpuUsage();
+    reverbSleeping.store(reverbAlgorithm.isReverbSleeping(), std::memory_order_relaxed);
 }
 
 //==============================================================================
@@ -196,15 +216,55 @@ juce::AudioProcessorValueTreeState::ParameterLayout SpreadraProcessor::createPar
     return { params.begin(), params.end() };
 }
 
+void SpreadraProcessor::timerCallback()
+{
+    updateParameters();
+    updateLatency();
+    reverbAlgorithm.releaseRetiredResources();
+}
+
 void SpreadraProcessor::updateParameters()
 {
     // Получение параметров из AudioProcessorValueTreeState
-    float dryWet = parameters.getRawParameterValue("dryWet")->load();
-    float stereoWidth = parameters.getRawParameterValue("stereoWidth")->load();
+    float dryWet = dryWetValue->load();
+    float stereoWidth = stereoWidthValue->load();
     
-    // Обновление параметров Spreadra-ядра
+    // Обновление параметров Spreadra-ядра - снимок только при изменении
     reverbAlgorithm.setDryWet(dryWet);
-    reverbAlgorithm.setStereoWidth(stereoWidth);
+    
+    if (stereoWidth != lastStereoWidth)
+    {
+        reverbAlgorithm.setStereoWidth(stereoWidth);
+        lastStereoWidth = stereoWidth;
+    }
+}
+
+void SpreadraProcessor::setEngineType(ReverbAlgorithm::EngineType newEngineType)
+{
+    // Задержку сообщит timerCallback() после переключения на аудио-потоке
+    reverbAlgorithm.setEngineType(newEngineType);
+}
+
+void SpreadraProcessor::setConvolutionPartitioning(ConvolutionEngine::Partitioning newPartitioning)
+{
+    reverbAlgorithm.setConvolutionPartitioning(newPartitioning);
+}
+
+void SpreadraProcessor::updateLatency()
+{
+    // Задержка, уже примененная аудио-потоком: хост не компенсирует
+    // переключение раньше, чем оно произошло. setLatencySamples() сам
+    // уведомляет хост (updateHostDisplay с флагом задержки)
+    const int latency = reverbAlgorithm.getLatencySamples();
+    
+    if (latency != reportedLatency)
+    {
+        reportedLatency = latency;
+        setLatencySamples(latency);
+    }
+    
+    // Обновление метрик
+    latencyMs = reverbAlgorithm.getLatency();
 }
 
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
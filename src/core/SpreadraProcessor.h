@@ -5,6 +5,7 @@
 #include "../dsp/ReverbAlgorithm.h"
 #include "ParameterManager.h"
 #include "utils/Logger.h"
+#include <atomic>
 
 /**
  * @brief Основной аудио-процессор для Spreadra плагина
@@ -15,7 +16,8 @@
  * - Интегрируется с JUCE AudioProcessor
  * - Управляет параметрами плагина
  */
-class SpreadraProcessor : public juce::AudioProcessor
+class SpreadraProcessor : public juce::AudioProcessor,
+                          private juce::Timer
 {
 public:
     //==============================================================================
@@ -60,9 +62,15 @@ public:
     // DSP компоненты
     ReverbAlgorithm& getReverbAlgorithm() { return reverbAlgorithm; }
     
+    // Выбор движка и разбиения свертки меняет задержку - через процессор:
+    // хост узнает о ней от таймера, когда аудио-поток уже переключился
+    void setEngineType(ReverbAlgorithm::EngineType newEngineType);
+    void setConvolutionPartitioning(ConvolutionEngine::Partitioning newPartitioning);
+    
     // Метрики производительности
     float getCpuUsage() const { return cpuUsage; }
     float getLatency() const { return latencyMs; }
+    bool isReverbSleeping() const { return reverbSleeping.load(std::memory_order_relaxed); }
 
 private:
     //==============================================================================
@@ -78,12 +86,28 @@ private:
     // Метрики производительности
     float cpuUsage = 0.0f;
     float latencyMs = 0.0f;
+    std::atomic<bool> reverbSleeping { false };    // Пишет аудио-поток, читает GUI
+    
+    // Сырые значения параметров (атомарные, пишет хост/GUI)
+    std::atomic<float>* dryWetValue = nullptr;
+    std::atomic<float>* stereoWidthValue = nullptr;
+    
+    // Последняя переданная в алгоритм ширина: updateParameters() вызывается
+    // таймером, а пересчет снимка движка нужен только при изменении
+    float lastStereoWidth = -1.0f;
+    
+    // Задержка, последней сообщенная хосту
+    int reportedLatency = 0;
     
     // Временные буферы
     juce::AudioBuffer<float> tempBuffer;
     
-    // Обработчики параметров
+    // Обработчики параметров. Снимки движков публикует только message thread
+    // (таймер) - аудио-поток их лишь забирает
+    static constexpr int parameterUpdateHz = 30;
+    void timerCallback() override;
     void updateParameters();
+    void updateLatency();
     
     // JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpreadraProcessor)
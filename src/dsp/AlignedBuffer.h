@@ -0,0 +1,76 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <vector>
+#include <cstdint>
+
+/**
+ * @brief Память float с началом на границе 64 байт
+ *
+ * std::vector и fftwf_malloc гарантируют только свое выравнивание (часто
+ * 16 байт), а SimdOps::load под AVX требует 32. Буфер берется с запасом
+ * в alignmentFloats, и начало сдвигается на ближайшую границу 64 байт
+ * (кэш-линия / AVX-512). Общая основа ScratchArena, DelayLineArena и
+ * строк спектров PartitionedConvolver. Выделение - вне аудио-потока.
+ */
+class AlignedBuffer
+{
+public:
+    //==============================================================================
+    static constexpr size_t alignmentFloats = 16;   // 64 байта
+
+    static constexpr size_t roundUpToAlignment(size_t numFloats)
+    {
+        return (numFloats + alignmentFloats - 1) / alignmentFloats * alignmentFloats;
+    }
+
+    //==============================================================================
+    AlignedBuffer() = default;
+    ~AlignedBuffer() = default;
+
+    // Новая обнуленная память на numFloats
+    void allocate(size_t numFloats)
+    {
+        storage.assign(numFloats + alignmentFloats, 0.0f);
+        alignStart(numFloats);
+    }
+
+    // Память перевыделяется, только если прежней не хватает (содержимое
+    // прежней не обнуляется)
+    void ensureSize(size_t numFloats)
+    {
+        if (storage.size() < numFloats + alignmentFloats)
+            storage.assign(numFloats + alignmentFloats, 0.0f);
+
+        alignStart(numFloats);
+    }
+
+    void release()
+    {
+        storage.clear();
+        storage.shrink_to_fit();
+        data = nullptr;
+        size = 0;
+    }
+
+    //==============================================================================
+    float* get() noexcept { return data; }
+    const float* get() const noexcept { return data; }
+    size_t getSize() const noexcept { return size; }
+
+private:
+    //==============================================================================
+    void alignStart(size_t numFloats)
+    {
+        auto address = reinterpret_cast<std::uintptr_t>(storage.data());
+        auto misalignment = (address / sizeof(float)) % alignmentFloats;
+        data = storage.data() + (misalignment == 0 ? 0 : alignmentFloats - misalignment);
+        size = numFloats;
+    }
+
+    std::vector<float> storage;
+    float* data = nullptr;
+    size_t size = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AlignedBuffer)
+};
@@ -0,0 +1,475 @@
+#include "CombBank.h"
+#include "SimdOps.h"
+#include "ReverbTopology.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+//==============================================================================
+CombBank::CombBank() = default;
+
+CombBank::~CombBank() = default;
+
+//==============================================================================
+void CombBank::prepare(int numCombsPerChannel, int numChannels)
+{
+    jassert(numCombsPerChannel > 0 && numCombsPerChannel <= maxCombsPerChannel);
+    jassert(numChannels > 0 && numChannels <= maxChannels);
+
+    this->numCombsPerChannel = juce::jlimit(0, maxCombsPerChannel, numCombsPerChannel);
+    this->numChannels = juce::jlimit(0, maxChannels, numChannels);
+
+    // Активные дорожки каждого канала дополняются до целого числа векторных регистров
+    lanesPerChannel = paddedLaneCount(this->numCombsPerChannel);
+    numLanes = maxCombsPerChannel * this->numChannels;
+
+    feedback.fill(0.0f);
+    gain.fill(0.0f);
+    currentDelay.fill(0.0f);
+    targetDelay.fill(0.0f);
+    delayChangeRate.fill(0.0f);
+    delayed.fill(0.0f);
+    combOutput.fill(0.0f);
+    interpolatorState.fill(0.0f);
+    fadeProgress.fill(0.0f);
+    fadeStep.fill(0.0f);
+    fadeFromDelay.fill(0);
+
+    for (auto& line : lines)
+        line = DelayLine();
+
+    // Пустые дорожки сохраняют нулевой gain - их выход всегда 0
+    setDamping(damping);
+}
+
+void CombBank::reset()
+{
+    // Линии сбрасываются за O(1), старые отсчеты обнуляются в processTopology()
+    for (int lane = 0; lane < numLanes; ++lane)
+        lines[lane].clearLazily();
+
+    delayed.fill(0.0f);
+    combOutput.fill(0.0f);
+    interpolatorState.fill(0.0f);
+}
+
+void CombBank::setNumCombsPerChannel(int newNumCombs)
+{
+    newNumCombs = juce::jlimit(1, maxCombsPerChannel, newNumCombs);
+
+    if (newNumCombs == numCombsPerChannel)
+        return;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        for (int comb = 0; comb < maxCombsPerChannel; ++comb)
+        {
+            const int lane = laneIndex(channel, comb);
+
+            if (comb >= newNumCombs)
+            {
+                // Выключенная дорожка не дает вклада в сумму канала
+                feedback[lane] = 0.0f;
+                gain[lane] = 0.0f;
+                delayed[lane] = 0.0f;
+                combOutput[lane] = 0.0f;
+            }
+            else if (comb >= numCombsPerChannel)
+            {
+                // Включенная дорожка: чистая линия, задержка - при первом glideToDelay()
+                lines[lane].clearLazily();
+                feedback[lane] = feedback[laneIndex(channel, 0)];
+                gain[lane] = 1.0f - damping;
+                interpolatorState[lane] = 0.0f;
+            }
+
+            if (comb >= juce::jmin(numCombsPerChannel, newNumCombs))
+            {
+                currentDelay[lane] = 0.0f;
+                targetDelay[lane] = 0.0f;
+                delayChangeRate[lane] = 0.0f;
+                fadeStep[lane] = 0.0f;
+            }
+        }
+    }
+
+    numCombsPerChannel = newNumCombs;
+    lanesPerChannel = paddedLaneCount(numCombsPerChannel);
+}
+
+//==============================================================================
+void CombBank::setMaximumDelay(int channel, int comb, int maxDelaySamples, DelayLineArena& arena)
+{
+    lines[laneIndex(channel, comb)].setMaximumDelay(maxDelaySamples, arena);
+}
+
+void CombBank::setDelay(int channel, int comb, float delaySamples)
+{
+    const int lane = laneIndex(channel, comb);
+    currentDelay[lane] = delaySamples;
+    targetDelay[lane] = delaySamples;
+    delayChangeRate[lane] = 0.0f;
+    fadeStep[lane] = 0.0f;
+}
+
+void CombBank::glideToDelay(int channel, int comb, float delaySamples, float transitionSpeed)
+{
+    const int lane = laneIndex(channel, comb);
+
+    // Инициализация fractional delay при первом использовании
+    if (currentDelay[lane] == 0.0f)
+    {
+        currentDelay[lane] = delaySamples;
+        targetDelay[lane] = delaySamples;
+        return;
+    }
+
+    // Интерполятор Тирана стартует с текущего выхода линии, а не с нуля
+    if (currentDelay[lane] == targetDelay[lane])
+        interpolatorState[lane] = lines[lane].read(static_cast<int>(currentDelay[lane]));
+
+    // Устанавливаем новую цель и скорость плавного перехода
+    targetDelay[lane] = delaySamples;
+    delayChangeRate[lane] = (targetDelay[lane] - currentDelay[lane]) * transitionSpeed;
+}
+
+void CombBank::crossfadeToDelay(int channel, int comb, float delaySamples, int fadeSamples)
+{
+    const int lane = laneIndex(channel, comb);
+
+    // Инициализация при первом использовании - без перехода
+    if (currentDelay[lane] == 0.0f)
+    {
+        setDelay(channel, comb, delaySamples);
+        return;
+    }
+
+    // Идущий кроссфейд не прерывается: новая цель подхватится после него
+    targetDelay[lane] = delaySamples;
+
+    if (fadeStep[lane] > 0.0f || currentDelay[lane] == delaySamples)
+        return;
+
+    fadeFromDelay[lane] = static_cast<int>(currentDelay[lane]);
+    currentDelay[lane] = delaySamples;
+    fadeProgress[lane] = 0.0f;
+    fadeStep[lane] = 1.0f / static_cast<float>(juce::jmax(1, fadeSamples));
+}
+
+void CombBank::finishTransitions()
+{
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        currentDelay[lane] = targetDelay[lane];
+        delayChangeRate[lane] = 0.0f;
+        fadeStep[lane] = 0.0f;
+    }
+}
+
+void CombBank::setFeedback(float newFeedback)
+{
+    for (int channel = 0; channel < numChannels; ++channel)
+        for (int comb = 0; comb < numCombsPerChannel; ++comb)
+            feedback[laneIndex(channel, comb)] = newFeedback;
+}
+
+void CombBank::setDamping(float newDamping)
+{
+    damping = newDamping;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        for (int comb = 0; comb < numCombsPerChannel; ++comb)
+            gain[laneIndex(channel, comb)] = 1.0f - damping;
+}
+
+//==============================================================================
+void CombBank::process(const float* const* inputs, float* const* outputs, int numSamples)
+{
+    process(inputs, outputs, numSamples, numChannels);
+}
+
+void CombBank::process(const float* const* inputs, float* const* outputs, int numSamples, int numChannelsToProcess)
+{
+    if (isEmpty())
+        return;
+
+    const int activeChannels = juce::jlimit(1, numChannels, numChannelsToProcess);
+
+    // Специализированные топологии - ядра с числом фильтров времени компиляции
+    switch (numCombsPerChannel)
+    {
+        case ReverbTopologies::compact.numCombs: processWithChannels<ReverbTopologies::compact.numCombs>(inputs, outputs, numSamples, activeChannels); break;
+        case ReverbTopologies::classic.numCombs: processWithChannels<ReverbTopologies::classic.numCombs>(inputs, outputs, numSamples, activeChannels); break;
+        case ReverbTopologies::dense.numCombs:   processWithChannels<ReverbTopologies::dense.numCombs>(inputs, outputs, numSamples, activeChannels); break;
+        default:                                 processWithChannels<0>(inputs, outputs, numSamples, activeChannels); break;
+    }
+}
+
+template <int FixedCombs>
+void CombBank::processWithChannels(const float* const* inputs, float* const* outputs, int numSamples, int activeChannels)
+{
+    static_assert(maxChannels == 2, "Диспетчер рассчитан на моно и стерео");
+
+    if (activeChannels == 1)
+        processTopology<FixedCombs, 1>(inputs, outputs, numSamples);
+    else
+        processTopology<FixedCombs, 2>(inputs, outputs, numSamples);
+}
+
+template <int FixedCombs, int Channels>
+void CombBank::processTopology(const float* const* inputs, float* const* outputs, int numSamples)
+{
+    const int numCombs = FixedCombs > 0 ? FixedCombs : numCombsPerChannel;
+
+    // Лениво сброшенные линии обнуляют участок, который прочитает этот блок
+    for (int channel = 0; channel < Channels; ++channel)
+    {
+        for (int comb = 0; comb < numCombs; ++comb)
+        {
+            const int lane = laneIndex(channel, comb);
+            float nearest = juce::jmin(currentDelay[lane], targetDelay[lane]);
+            float farthest = juce::jmax(currentDelay[lane], targetDelay[lane]);
+
+            if (fadeStep[lane] > 0.0f)
+            {
+                nearest = juce::jmin(nearest, static_cast<float>(fadeFromDelay[lane]));
+                farthest = juce::jmax(farthest, static_cast<float>(fadeFromDelay[lane]));
+            }
+
+            lines[lane].prepareBlock(nearest, farthest, numSamples);
+        }
+    }
+
+    // Задержки меняются только после glideToDelay()/crossfadeToDelay() -
+    // в остальное время работает специализированное ядро с целым чтением
+    if (isCrossfading(Channels, numCombs))
+    {
+        processBlock<LaneRead::Crossfading, InterpolationMode::None, FixedCombs, Channels>(inputs, outputs, numSamples);
+    }
+    else if (isGliding(Channels, numCombs))
+    {
+        // Качество интерполяции - параметр шаблона: у каждого режима свой цикл
+        switch (interpolation)
+        {
+            case InterpolationMode::None:    processBlock<LaneRead::Gliding, InterpolationMode::None, FixedCombs, Channels>(inputs, outputs, numSamples); break;
+            case InterpolationMode::Linear:  processBlock<LaneRead::Gliding, InterpolationMode::Linear, FixedCombs, Channels>(inputs, outputs, numSamples); break;
+            case InterpolationMode::Hermite: processBlock<LaneRead::Gliding, InterpolationMode::Hermite, FixedCombs, Channels>(inputs, outputs, numSamples); break;
+            case InterpolationMode::Thiran:  processBlock<LaneRead::Gliding, InterpolationMode::Thiran, FixedCombs, Channels>(inputs, outputs, numSamples); break;
+        }
+    }
+    else
+    {
+        int minimumDelay = std::numeric_limits<int>::max();
+
+        for (int channel = 0; channel < Channels; ++channel)
+        {
+            for (int comb = 0; comb < numCombs; ++comb)
+            {
+                const int lane = laneIndex(channel, comb);
+                integerDelay[lane] = static_cast<int>(currentDelay[lane]);
+                minimumDelay = juce::jmin(minimumDelay, integerDelay[lane]);
+            }
+        }
+
+        if (minimumDelay >= DelayLine::minimumChunkLength)
+            processChunked<FixedCombs, Channels>(inputs, outputs, numSamples);
+        else
+            processBlock<LaneRead::Integer, InterpolationMode::Linear, FixedCombs, Channels>(inputs, outputs, numSamples);
+    }
+}
+
+bool CombBank::isGliding() const
+{
+    return isGliding(numChannels, numCombsPerChannel);
+}
+
+bool CombBank::isCrossfading() const
+{
+    return isCrossfading(numChannels, numCombsPerChannel);
+}
+
+bool CombBank::isGliding(int activeChannels, int numCombs) const
+{
+    for (int channel = 0; channel < activeChannels; ++channel)
+        for (int comb = 0; comb < numCombs; ++comb)
+            if (currentDelay[laneIndex(channel, comb)] != targetDelay[laneIndex(channel, comb)])
+                return true;
+
+    return false;
+}
+
+bool CombBank::isCrossfading(int activeChannels, int numCombs) const
+{
+    for (int channel = 0; channel < activeChannels; ++channel)
+        for (int comb = 0; comb < numCombs; ++comb)
+            if (fadeStep[laneIndex(channel, comb)] > 0.0f)
+                return true;
+
+    return false;
+}
+
+template <CombBank::LaneRead Read, InterpolationMode Mode, int FixedCombs, int Channels>
+void CombBank::processBlock(const float* const* inputs, float* const* outputs, int numSamples)
+{
+    using namespace SimdOps;
+
+    // FixedCombs == 0 - число фильтров во время выполнения
+    const int numCombs = FixedCombs > 0 ? FixedCombs : numCombsPerChannel;
+    const int numChannelLanes = FixedCombs > 0 ? paddedLaneCount(FixedCombs) : lanesPerChannel;
+    const float normalization = 1.0f / static_cast<float>(numCombs);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if constexpr (Read == LaneRead::Gliding)
+            advanceGlides();
+
+        // Чтение задержанных сэмплов всех фильтров (gather)
+        for (int channel = 0; channel < Channels; ++channel)
+        {
+            for (int comb = 0; comb < numCombs; ++comb)
+            {
+                const int lane = laneIndex(channel, comb);
+
+                if constexpr (Read == LaneRead::Gliding)
+                    delayed[lane] = lines[lane].readInterpolated<Mode>(currentDelay[lane], interpolatorState[lane]);
+                else if constexpr (Read == LaneRead::Crossfading)
+                    delayed[lane] = readCrossfade(lane);
+                else
+                    delayed[lane] = lines[lane].read(integerDelay[lane]);
+            }
+        }
+
+        // ПРАВИЛЬНАЯ COMB FORMULA: y[n] = (x[n] + g*y[n-M]) * (1 - damping) - сразу для всех дорожек.
+        // Дорожки канала занимают целые регистры, поэтому вход канала - один broadcast
+        for (int channel = 0; channel < Channels; ++channel)
+        {
+            const Vec x = broadcast(inputs[channel][i]);
+            const int firstLane = laneIndex(channel, 0);
+
+            for (int lane = firstLane; lane < firstLane + numChannelLanes; lane += width)
+            {
+                const Vec feedbackSample = mul(load(&feedback[lane]), load(&delayed[lane]));
+                store(&combOutput[lane], mul(add(x, feedbackSample), load(&gain[lane])));
+            }
+        }
+
+        // Запись в линии задержки (scatter)
+        for (int channel = 0; channel < Channels; ++channel)
+        {
+            for (int comb = 0; comb < numCombs; ++comb)
+            {
+                const int lane = laneIndex(channel, comb);
+                lines[lane].push(combOutput[lane]);
+            }
+        }
+
+        // Нормализованная сумма дорожек канала
+        for (int channel = 0; channel < Channels; ++channel)
+        {
+            const float* channelLanes = &combOutput[static_cast<size_t>(laneIndex(channel, 0))];
+            Vec acc = load(channelLanes);
+
+            for (int lane = width; lane < numChannelLanes; lane += width)
+                acc = add(acc, load(channelLanes + lane));
+
+            outputs[channel][i] = SimdOps::sum(acc) * normalization;
+        }
+    }
+}
+
+template <int FixedCombs, int Channels>
+void CombBank::processChunked(const float* const* inputs, float* const* outputs, int numSamples)
+{
+    using namespace SimdOps;
+
+    const int numCombs = FixedCombs > 0 ? FixedCombs : numCombsPerChannel;
+
+    for (int channel = 0; channel < Channels; ++channel)
+    {
+        const float* input = inputs[channel];
+        float* output = outputs[channel];
+        std::fill(output, output + numSamples, 0.0f);
+
+        for (int comb = 0; comb < numCombs; ++comb)
+        {
+            const int lane = laneIndex(channel, comb);
+            const float laneFeedback = feedback[lane];
+            const float laneGain = gain[lane];
+            const Vec feedbackVec = broadcast(laneFeedback);
+            const Vec gainVec = broadcast(laneGain);
+
+            // y[n] = (x[n] + g*y[n-M]) * (1 - damping): внутри участка длиной <= M
+            // все y[n-M] уже записаны, цикл по времени векторизуется
+            lines[lane].processInChunks(integerDelay[lane], numSamples,
+                [&] (const float* delayedSamples, float* writeSamples, int offset, int count)
+                {
+                    const float* x = input + offset;
+                    float* out = output + offset;
+                    int i = 0;
+
+                    for (; i + width <= count; i += width)
+                    {
+                        const Vec feedbackSample = mul(feedbackVec, loadUnaligned(delayedSamples + i));
+                        const Vec y = mul(add(loadUnaligned(x + i), feedbackSample), gainVec);
+                        storeUnaligned(writeSamples + i, y);
+                        storeUnaligned(out + i, add(loadUnaligned(out + i), y));
+                    }
+
+                    for (; i < count; ++i)
+                    {
+                        const float y = (x[i] + laneFeedback * delayedSamples[i]) * laneGain;
+                        writeSamples[i] = y;
+                        out[i] += y;
+                    }
+                });
+        }
+
+        // Нормализованная сумма comb фильтров канала
+        const float normalization = 1.0f / static_cast<float>(numCombs);
+        for (int i = 0; i < numSamples; ++i)
+            output[i] *= normalization;
+    }
+}
+
+//==============================================================================
+float CombBank::readCrossfade(int lane) noexcept
+{
+    const float newTap = lines[lane].read(static_cast<int>(currentDelay[lane]));
+
+    if (fadeStep[lane] == 0.0f)
+        return newTap;
+
+    float fadeOut, fadeIn;
+    DelayLine::crossfadeGains(fadeProgress[lane], fadeOut, fadeIn);
+    const float sample = fadeOut * lines[lane].read(fadeFromDelay[lane]) + fadeIn * newTap;
+
+    fadeProgress[lane] += fadeStep[lane];
+
+    if (fadeProgress[lane] >= 1.0f)
+    {
+        fadeProgress[lane] = 0.0f;
+
+        // Отложенная цель - следующий кроссфейд той же длины, иначе один отвод
+        if (targetDelay[lane] != currentDelay[lane])
+        {
+            fadeFromDelay[lane] = static_cast<int>(currentDelay[lane]);
+            currentDelay[lane] = targetDelay[lane];
+        }
+        else
+        {
+            fadeStep[lane] = 0.0f;
+        }
+    }
+
+    return sample;
+}
+
+void CombBank::advanceGlides()
+{
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        // FRACTIONAL DELAY: Плавное изменение времени задержки
+        if (currentDelay[lane] != targetDelay[lane])
+            currentDelay[lane] = DelayLine::stepDelayGlide(currentDelay[lane], targetDelay[lane], delayChangeRate[lane]);
+    }
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <array>
+#include <vector>
+#include "DelayLine.h"
+
+/**
+ * @brief Банк параллельных comb фильтров в раскладке structure-of-arrays
+ *
+ * Все comb фильтры обоих каналов хранятся как "дорожки" (lanes) векторного
+ * регистра: feedback, damping и дробные задержки лежат в выровненных
+ * массивах, по дорожке на фильтр, у каждой дорожки своя DelayLine
+ * (память линий - из общей DelayLineArena движка).
+ * За один проход по блоку банк продвигает все фильтры одновременно,
+ * арифметика считается через SSE/AVX, а не двенадцатью скалярными проходами.
+ *
+ * Каждый канал занимает maxCombsPerChannel дорожек, активные фильтры
+ * дополняются до laneAlignment, неиспользуемые дорожки имеют нулевой gain
+ * и не дают вклада в выход. Число активных фильтров меняется на ходу
+ * (setNumCombsPerChannel) без перераскладки дорожек и без выделения памяти.
+ */
+class CombBank
+{
+public:
+    //==============================================================================
+    static constexpr int maxChannels = 2;
+    static constexpr int maxCombsPerChannel = 16;
+    static constexpr int laneAlignment = 8;     // Одна AVX дорожка или две SSE
+    static constexpr int maxLanes = maxChannels * maxCombsPerChannel;
+
+    //==============================================================================
+    CombBank();
+    ~CombBank();
+
+    //==============================================================================
+    // Подготовка
+    void prepare(int numCombsPerChannel, int numChannels);
+    void reset();
+
+    // Смена числа активных фильтров (аудио-поток). Включенные дорожки
+    // начинают с чистой линией, задержку им задает следующий glideToDelay()
+    void setNumCombsPerChannel(int newNumCombs);
+
+    //==============================================================================
+    // Основная обработка: по входу и выходу на канал.
+    // Выход канала - нормализованная сумма его comb фильтров.
+    void process(const float* const* inputs, float* const* outputs, int numSamples);
+
+    // Обработка только первых numChannelsToProcess каналов (моно путь):
+    // линии остальных каналов не читаются и не пишутся
+    void process(const float* const* inputs, float* const* outputs, int numSamples, int numChannelsToProcess);
+
+    //==============================================================================
+    // Конфигурация отдельных фильтров
+    void setMaximumDelay(int channel, int comb, int maxDelaySamples, DelayLineArena& arena);
+    void setDelay(int channel, int comb, float delaySamples);
+    void glideToDelay(int channel, int comb, float delaySamples, float transitionSpeed);
+
+    // Переход кроссфейдом двух целых отводов за fadeSamples сэмплов. Цель,
+    // пришедшая во время кроссфейда, ждет его окончания и начинает следующий
+    void crossfadeToDelay(int channel, int comb, float delaySamples, int fadeSamples);
+
+    // Мгновенное завершение всех переходов (смена DelayTransition)
+    void finishTransitions();
+
+    void setFeedback(float newFeedback);
+    void setDamping(float newDamping);
+    void setInterpolationMode(InterpolationMode newMode) { interpolation = newMode; }
+
+    //==============================================================================
+    // Состояние
+    int getNumCombsPerChannel() const { return numCombsPerChannel; }
+    int getNumChannels() const { return numChannels; }
+    bool isEmpty() const { return numCombsPerChannel == 0 || numChannels == 0; }
+    bool isGliding() const;
+    bool isCrossfading() const;
+
+    InterpolationMode getInterpolationMode() const { return interpolation; }
+    float getFeedback(int channel, int comb) const { return feedback[laneIndex(channel, comb)]; }
+    float getCurrentDelay(int channel, int comb) const { return currentDelay[laneIndex(channel, comb)]; }
+    float getTargetDelay(int channel, int comb) const { return targetDelay[laneIndex(channel, comb)]; }
+    int getMaximumDelay(int channel, int comb) const { return lines[laneIndex(channel, comb)].getMaximumDelay(); }
+
+private:
+    //==============================================================================
+    static int laneIndex(int channel, int comb) { return channel * maxCombsPerChannel + comb; }
+
+    static constexpr int paddedLaneCount(int combs) { return (combs + laneAlignment - 1) / laneAlignment * laneAlignment; }
+
+    // Ядра параметризованы числом фильтров (FixedCombs, 0 - во время выполнения)
+    // и каналов: для топологий из ReverbTopologies циклы по дорожкам разворачиваются
+    template <int FixedCombs>
+    void processWithChannels(const float* const* inputs, float* const* outputs, int numSamples, int activeChannels);
+    template <int FixedCombs, int Channels>
+    void processTopology(const float* const* inputs, float* const* outputs, int numSamples);
+
+    // Чтение задержанного сэмпла дорожки в посэмпловом ядре
+    enum class LaneRead
+    {
+        Integer,        // Статичная задержка, целое чтение
+        Gliding,        // Дробное чтение выбранного качества во время glide
+        Crossfading     // Два целых отвода во время кроссфейда
+    };
+
+    // Посэмпловое ядро: во время перехода задержек - glide или кроссфейд,
+    // при очень коротких статичных задержках - целое чтение
+    template <LaneRead Read, InterpolationMode Mode, int FixedCombs, int Channels>
+    void processBlock(const float* const* inputs, float* const* outputs, int numSamples);
+
+    // Статичные задержки: каждая дорожка считается участками не длиннее своей
+    // задержки с векторным циклом вдоль времени
+    template <int FixedCombs, int Channels>
+    void processChunked(const float* const* inputs, float* const* outputs, int numSamples);
+
+    void advanceGlides();
+    float readCrossfade(int lane) noexcept;
+
+    // Переходы только на обрабатываемых дорожках: моно путь не продвигает
+    // дорожки второго канала, и их переход не должен держать медленное ядро
+    bool isGliding(int activeChannels, int numCombs) const;
+    bool isCrossfading(int activeChannels, int numCombs) const;
+
+    //==============================================================================
+    int numCombsPerChannel = 0;
+    int numChannels = 0;
+    int lanesPerChannel = 0;    // Активные дорожки канала, дополненные до laneAlignment
+    int numLanes = 0;           // Все дорожки каналов, включая неактивные
+
+    // Горячее состояние по дорожкам
+    alignas(32) std::array<float, maxLanes> feedback {};
+    alignas(32) std::array<float, maxLanes> gain {};            // 1 - damping, 0 для пустых дорожек
+    alignas(32) std::array<float, maxLanes> currentDelay {};
+    alignas(32) std::array<float, maxLanes> targetDelay {};
+    alignas(32) std::array<float, maxLanes> delayChangeRate {};
+    alignas(32) std::array<float, maxLanes> delayed {};
+    alignas(32) std::array<float, maxLanes> combOutput {};
+    alignas(32) std::array<float, maxLanes> interpolatorState {};   // Состояние Thiran
+    alignas(32) std::array<float, maxLanes> fadeProgress {};        // Кроссфейд: 0..1
+    alignas(32) std::array<float, maxLanes> fadeStep {};            // 0 - кроссфейда нет
+    std::array<int, maxLanes> fadeFromDelay {};                     // Старый отвод
+    std::array<int, maxLanes> integerDelay {};
+
+    // Линии задержки
+    std::array<DelayLine, maxLanes> lines;
+
+    float damping = 0.0f;
+    InterpolationMode interpolation = InterpolationMode::Linear;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CombBank)
+};
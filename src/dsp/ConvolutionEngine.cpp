@@ -0,0 +1,311 @@
+#include "ConvolutionEngine.h"
+#include "utils/MathUtils.h"
+#include <algorithm>
+#include <cmath>
+
+//==============================================================================
+ConvolutionEngine::ConvolutionEngine() = default;
+
+ConvolutionEngine::~ConvolutionEngine()
+{
+    // Аудио-поток остановлен: все наборы принадлежат этому потоку
+    delete activeSet;
+    delete pendingSet.exchange(nullptr);
+    delete retiredSet.exchange(nullptr);
+}
+
+void ConvolutionEngine::prepare(double sampleRate, int maxHostBlockSize)
+{
+    const int newPartitionSize = choosePartitionSize(maxHostBlockSize);
+
+    // При тех же частоте и размере части хвост и FDL сохраняются
+    if (isReady() && sampleRate == this->sampleRate && newPartitionSize == partitionSize)
+        return;
+
+    this->sampleRate = sampleRate;
+    partitionSize = newPartitionSize;
+
+    loadConvolvers();
+
+    isPrepared.store(true, std::memory_order_release);
+}
+
+void ConvolutionEngine::reset()
+{
+    // Новые наборы приходят сброшенными - сбрасывается только действующий
+    if (activeSet != nullptr)
+        activeSet->reset();
+}
+
+void ConvolutionEngine::ConvolverSet::reset()
+{
+    for (auto& convolver : convolvers)
+        convolver.reset();
+
+    for (auto& channelFifo : fifo)
+        std::fill(channelFifo.begin(), channelFifo.end(), 0.0f);
+
+    fifoPosition = 0;
+    zeroLatencyConvolver.reset();
+}
+
+void ConvolutionEngine::releaseRetiredSets()
+{
+    // Снятый набор аудио-поток больше не читает; рабочий поток свертки без
+    // задержки останавливается в деструкторе набора - здесь, а не в аудио
+    std::unique_ptr<ConvolverSet> retired(retiredSet.exchange(nullptr, std::memory_order_acquire));
+}
+
+void ConvolutionEngine::setPartitioning(Partitioning newPartitioning)
+{
+    if (newPartitioning == partitioning)
+        return;
+
+    partitioning = newPartitioning;
+
+    if (isReady())
+        loadConvolvers();
+}
+
+//==============================================================================
+void ConvolutionEngine::loadImpulseResponse(const float* const* channels, int numIRChannels,
+                                            int numSamples, double irSampleRate)
+{
+    numImpulseChannels = juce::jlimit(0, numChannels, numIRChannels);
+    impulseLength = numImpulseChannels > 0 ? juce::jmax(0, numSamples) : 0;
+    impulseSampleRate = irSampleRate;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto& stored = impulse[static_cast<size_t>(channel)];
+
+        if (channel < numImpulseChannels)
+            stored.assign(channels[channel], channels[channel] + impulseLength);
+        else
+            stored.clear();
+    }
+
+    if (isReady())
+        loadConvolvers();
+}
+
+void ConvolutionEngine::loadConvolvers()
+{
+    // Характеристика на частоте движка (та же частота - без пересчета)
+    const double ratio = impulseSampleRate / sampleRate;
+    const int resampledLength = impulseLength > 0
+        ? static_cast<int>(std::ceil(static_cast<double>(impulseLength) / ratio))
+        : 0;
+
+    std::array<std::vector<float>, numChannels> resampled;
+
+    for (int channel = 0; channel < numChannels && resampledLength > 0; ++channel)
+    {
+        // Моно характеристика - одна на оба канала
+        const auto& source = impulse[static_cast<size_t>(juce::jmin(channel, numImpulseChannels - 1))];
+        auto& destination = resampled[static_cast<size_t>(channel)];
+
+        destination.resize(static_cast<size_t>(resampledLength));
+
+        if (ratio == 1.0)
+            std::copy(source.begin(), source.begin() + impulseLength, destination.begin());
+        else
+            resampleImpulse(source.data(), impulseLength, ratio, destination.data(), resampledLength);
+    }
+
+    // Новый набор: части строятся только для выбранного разбиения
+    auto set = std::make_unique<ConvolverSet>();
+    set->partitioning = partitioning;
+    set->partitionSize = partitionSize;
+
+    const float* channels[numChannels] {};
+
+    for (int channel = 0; channel < numChannels; ++channel)
+        channels[channel] = resampledLength > 0 ? resampled[static_cast<size_t>(channel)].data() : nullptr;
+
+    if (partitioning == Partitioning::Uniform)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto& convolver = set->convolvers[static_cast<size_t>(channel)];
+            convolver.prepare(partitionSize, sampleRate);
+            convolver.loadImpulseResponse(channels[channel], resampledLength);
+
+            set->fifo[static_cast<size_t>(channel)].assign(static_cast<size_t>(partitionSize), 0.0f);
+        }
+    }
+    else
+    {
+        set->zeroLatencyConvolver.prepare(numChannels, sampleRate);
+        set->zeroLatencyConvolver.loadImpulseResponse(channels, resampledLength);
+    }
+
+    publishSet(std::move(set));
+}
+
+void ConvolutionEngine::publishSet(std::unique_ptr<ConvolverSet> set)
+{
+    releaseRetiredSets();
+
+    // Набор, который аудио-поток еще не принял, заменяется и удаляется сразу
+    std::unique_ptr<ConvolverSet> superseded(pendingSet.exchange(set.release(), std::memory_order_acq_rel));
+}
+
+void ConvolutionEngine::applyPendingSet() noexcept
+{
+    // Пока снятый набор не удален, новый ждет: аудио-поток не освобождает память
+    if (pendingSet.load(std::memory_order_relaxed) == nullptr
+        || retiredSet.load(std::memory_order_relaxed) != nullptr)
+        return;
+
+    ConvolverSet* incoming = pendingSet.exchange(nullptr, std::memory_order_acquire);
+
+    if (incoming == nullptr)
+        return;
+
+    retiredSet.store(activeSet, std::memory_order_release);
+    activeSet = incoming;
+
+    activeLatency.store(activeSet->partitioning == Partitioning::ZeroLatency ? 0 : activeSet->partitionSize,
+                        std::memory_order_release);
+}
+
+//==============================================================================
+void ConvolutionEngine::process(const float* input, float* output, int numSamples)
+{
+    if (! isReady())
+        return;
+
+    // Моно путь - первый канал характеристики
+    const float* inputs[] = { input };
+    float* outputs[] = { output };
+
+    processChannels(inputs, outputs, 1, numSamples);
+}
+
+void ConvolutionEngine::processStereo(const float* inputL, const float* inputR,
+                                      float* outputL, float* outputR, int numSamples)
+{
+    if (! isReady())
+        return;
+
+    const float* inputs[] = { inputL, inputR };
+    float* outputs[] = { outputL, outputR };
+
+    processChannels(inputs, outputs, numChannels, numSamples);
+}
+
+void ConvolutionEngine::processChannels(const float* const* inputs, float* const* outputs,
+                                        int activeChannels, int numSamples)
+{
+    if (activeSet == nullptr)
+    {
+        for (int channel = 0; channel < activeChannels; ++channel)
+            std::fill(outputs[channel], outputs[channel] + numSamples, 0.0f);
+
+        return;
+    }
+
+    auto& set = *activeSet;
+
+    if (set.partitioning == Partitioning::ZeroLatency)
+    {
+        set.zeroLatencyConvolver.process(inputs, outputs, activeChannels, numSamples);
+        return;
+    }
+
+    const int partitionSize = set.partitionSize;
+    auto& fifo = set.fifo;
+    int& fifoPosition = set.fifoPosition;
+
+    for (int done = 0; done < numSamples;)
+    {
+        const int count = juce::jmin(numSamples - done, partitionSize - fifoPosition);
+
+        for (int channel = 0; channel < activeChannels; ++channel)
+        {
+            const float* input = inputs[channel] + done;
+            float* output = outputs[channel] + done;
+            float* slots = fifo[static_cast<size_t>(channel)].data() + fifoPosition;
+
+            // Вход занимает место выданного сэмпла выхода (in-place безопасно)
+            for (int i = 0; i < count; ++i)
+            {
+                const float sample = input[i];
+                output[i] = slots[i];
+                slots[i] = sample;
+            }
+        }
+
+        done += count;
+        fifoPosition += count;
+
+        // Часть набрана: свертка на месте, FIFO снова хранит выход
+        if (fifoPosition == partitionSize)
+        {
+            for (int channel = 0; channel < activeChannels; ++channel)
+            {
+                float* slots = fifo[static_cast<size_t>(channel)].data();
+                set.convolvers[static_cast<size_t>(channel)].process(slots, slots);
+            }
+
+            fifoPosition = 0;
+        }
+    }
+}
+
+//==============================================================================
+int ConvolutionEngine::choosePartitionSize(int maxHostBlockSize)
+{
+    const int size = juce::nextPowerOfTwo(juce::jmax(1, maxHostBlockSize));
+    return juce::jlimit(minPartitionSize, maxPartitionSize, size);
+}
+
+void ConvolutionEngine::resampleImpulse(const float* source, int sourceLength, double ratio,
+                                        float* destination, int destinationLength)
+{
+    // Окно-sinc (Блэкман) со срезом ниже меньшего из двух Найквистов: при
+    // понижении частоты все, что выше нового Найквиста, подавляется до
+    // прореживания и не заворачивается в слышимую полосу. Ядро - таблица
+    // по расстоянию в пересечениях нуля с линейной интерполяцией
+    const double pi = static_cast<double>(MathUtils::PI);
+    const int tableSize = resamplerZeroCrossings * resamplerTableResolution;
+    std::vector<float> kernel(static_cast<size_t>(tableSize + 2), 0.0f);
+
+    for (int k = 0; k <= tableSize; ++k)
+    {
+        const double u = static_cast<double>(k) / resamplerTableResolution;
+        const double window = 0.42 + 0.5 * std::cos(pi * u / resamplerZeroCrossings)
+                                   + 0.08 * std::cos(2.0 * pi * u / resamplerZeroCrossings);
+        const double sinc = k == 0 ? 1.0 : std::sin(pi * u) / (pi * u);
+
+        kernel[static_cast<size_t>(k)] = static_cast<float>(sinc * window);
+    }
+
+    // Срез в долях Найквиста источника; ядро растягивается обратно срезу
+    const double cutoff = resamplerPassband * juce::jmin(1.0, 1.0 / ratio);
+    const double halfWidth = resamplerZeroCrossings / cutoff;
+    const double tableScale = cutoff * resamplerTableResolution;
+
+    for (int i = 0; i < destinationLength; ++i)
+    {
+        const double position = static_cast<double>(i) * ratio;
+        const int first = juce::jmax(0, static_cast<int>(std::ceil(position - halfWidth)));
+        const int last = juce::jmin(sourceLength - 1, static_cast<int>(std::floor(position + halfWidth)));
+
+        double sum = 0.0;
+
+        for (int j = first; j <= last; ++j)
+        {
+            const double tablePosition = std::abs(static_cast<double>(j) - position) * tableScale;
+            const int index = juce::jmin(tableSize, static_cast<int>(tablePosition));
+            const float fraction = static_cast<float>(tablePosition - static_cast<double>(index));
+            const float tap = kernel[static_cast<size_t>(index)]
+                            + fraction * (kernel[static_cast<size_t>(index + 1)] - kernel[static_cast<size_t>(index)]);
+
+            sum += static_cast<double>(source[j] * tap);
+        }
+
+        destination[i] = static_cast<float>(sum * cutoff);
+    }
+}
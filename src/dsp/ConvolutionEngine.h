@@ -0,0 +1,144 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "PartitionedConvolver.h"
+#include "NonUniformConvolver.h"
+
+/**
+ * @brief Сверточная реверберация по импульсной характеристике
+ *
+ * Каждый канал сворачивается PartitionedConvolver (UPOLS) со своим каналом
+ * характеристики (моно характеристика - одна на оба канала). Размер части
+ * следует за максимальным блоком хоста (ближайшая степень двойки): одно
+ * прямое и одно обратное FFT на блок хоста, а число частей для хвоста в
+ * 3-10 с остается небольшим.
+ *
+ * Вход копится в FIFO на одну часть, поэтому блоки любого размера (в том
+ * числе микро-блоки ReverbAlgorithm) дают один и тот же результат, а
+ * задержка равна размеру части - getLatencySamples().
+ *
+ * Для живого мониторинга есть разбиение ZeroLatency (NonUniformConvolver):
+ * голова в прямой форме и растущие части хвоста на рабочем потоке -
+ * задержка ноль ценой потока и чуть большей стоимости головы.
+ *
+ * Потоки: свертки под текущие характеристику, частоту и разбиение (набор)
+ * строятся целиком вне аудио-потока и передаются ему атомарной заменой
+ * указателя. Аудио-поток принимает новый набор на границе блока
+ * (applyPendingSet()), а снятый удаляется вне аудио-потока
+ * (releaseRetiredSets() или следующая загрузка).
+ */
+class ConvolutionEngine
+{
+public:
+    //==============================================================================
+    static constexpr int numChannels = 2;
+    static constexpr int minPartitionSize = 64;
+    static constexpr int maxPartitionSize = 4096;
+    static constexpr int maxLatencySamples = maxPartitionSize;     // Верхняя граница getLatencySamples()
+
+    enum class Partitioning
+    {
+        Uniform,        // UPOLS, задержка - одна часть
+        ZeroLatency     // Неравномерное разбиение, задержка ноль
+    };
+
+    //==============================================================================
+    ConvolutionEngine();
+    ~ConvolutionEngine();
+
+    //==============================================================================
+    // Основная обработка: только wet сигнал
+    void process(const float* input, float* output, int numSamples);
+    void processStereo(const float* inputL, const float* inputR,
+                      float* outputL, float* outputR, int numSamples);
+
+    //==============================================================================
+    // Подготовка (вне аудио-потока): при тех же частоте и размере части
+    // состояние сохраняется. reset() - не одновременно с process()
+    void prepare(double sampleRate, int maxHostBlockSize);
+    void reset();
+    bool isReady() const { return isPrepared.load(std::memory_order_acquire); }
+
+    // Прием нового набора (аудио-поток, граница блока; или при остановленном аудио)
+    void applyPendingSet() noexcept;
+
+    // Удаление набора, снятого аудио-потоком (вне аудио-потока)
+    void releaseRetiredSets();
+
+    //==============================================================================
+    // Импульсная характеристика: 1 или 2 канала, при другой частоте
+    // дискретизации пересчитывается с ограничением полосы (окно-sinc).
+    // Строит новый набор сверток - не с аудио-потока
+    void loadImpulseResponse(const float* const* channels, int numIRChannels,
+                             int numSamples, double irSampleRate);
+    bool hasImpulseResponse() const { return impulseLength > 0; }
+
+    // Строит новый набор сверток - не с аудио-потока
+    void setPartitioning(Partitioning newPartitioning);
+    Partitioning getPartitioning() const { return partitioning; }
+
+    //==============================================================================
+    int getPartitionSize() const { return partitionSize; }
+
+    // Задержка принятого аудио-потоком набора
+    int getLatencySamples() const { return activeLatency.load(std::memory_order_acquire); }
+
+private:
+    //==============================================================================
+    // Состояние
+    double sampleRate = 44100.0;
+    int partitionSize = 512;
+    Partitioning partitioning = Partitioning::Uniform;
+    std::atomic<bool> isPrepared { false };
+
+    // Исходная характеристика (для пересчета при смене частоты)
+    std::array<std::vector<float>, numChannels> impulse;
+    int numImpulseChannels = 0;
+    int impulseLength = 0;
+    double impulseSampleRate = 44100.0;
+
+    // Набор сверток: готовится только выбранное разбиение
+    struct ConvolverSet
+    {
+        Partitioning partitioning = Partitioning::Uniform;
+        int partitionSize = 0;
+
+        std::array<PartitionedConvolver, numChannels> convolvers;
+        NonUniformConvolver zeroLatencyConvolver;
+
+        // FIFO на одну часть: сэмпл входа меняется местами с готовым выходом
+        std::array<std::vector<float>, numChannels> fifo;
+        int fifoPosition = 0;
+
+        void reset();
+    };
+
+    // Действующий набор принадлежит аудио-потоку. Новый ждет в pendingSet,
+    // снятый - в retiredSet: аудио-поток только кладет туда, удаляет другой поток
+    ConvolverSet* activeSet = nullptr;
+    std::atomic<ConvolverSet*> pendingSet { nullptr };
+    std::atomic<ConvolverSet*> retiredSet { nullptr };
+    std::atomic<int> activeLatency { 0 };
+
+    //==============================================================================
+    void loadConvolvers();
+    void publishSet(std::unique_ptr<ConvolverSet> set);
+    void processChannels(const float* const* inputs, float* const* outputs,
+                         int activeChannels, int numSamples);
+
+    static int choosePartitionSize(int maxHostBlockSize);
+
+    // Пересчет частоты характеристики: ratio - шаг по источнику на сэмпл выхода
+    static constexpr int resamplerZeroCrossings = 32;
+    static constexpr int resamplerTableResolution = 512;    // Точек таблицы ядра на пересечение нуля
+    static constexpr double resamplerPassband = 0.95;       // Доля меньшего Найквиста
+
+    static void resampleImpulse(const float* source, int sourceLength, double ratio,
+                                float* destination, int destinationLength);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ConvolutionEngine)
+};
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <cmath>
+#include <cstdint>
+#include "DelayLineArena.h"
+#include "LazyClear.h"
+
+/**
+ * @brief Качество дробного чтения задержки
+ *
+ * - None: ближайший целый отсчет, самый дешевый
+ * - Linear: линейная интерполяция между двумя отсчетами
+ * - Hermite: 4-точечный кубический Эрмит, меньше ослабление ВЧ
+ * - Thiran: all-pass 1-го порядка, плоская АЧХ; хранит состояние
+ */
+enum class InterpolationMode
+{
+    None,
+    Linear,
+    Hermite,
+    Thiran
+};
+
+/**
+ * @brief Способ перехода к новой задержке (смена roomSize)
+ *
+ * - Glide: задержка плавно едет к цели, чтение дробное - во время перехода
+ *   слышен сдвиг высоты тона
+ * - Crossfade: два целых отвода, старый и новый, с плавным кроссфейдом
+ *   заданной длины; после перехода снова один отвод
+ */
+enum class DelayTransition
+{
+    Glide,
+    Crossfade
+};
+
+/**
+ * @brief Кольцевая линия задержки с емкостью степени двойки
+ *
+ * Емкость округляется вверх до степени двойки, поэтому перенос индекса -
+ * это одна битовая маска вместо деления по модулю. Дробное чтение
+ * выполняется без ветвлений: целая часть задержки маскируется, дробная
+ * используется как коэффициент линейной интерполяции.
+ *
+ * Задержка отсчитывается от следующей позиции записи: read(1) возвращает
+ * последний записанный сэмпл. Поэтому чтение выполняется до push()
+ * текущего сэмпла.
+ *
+ * Линия не владеет памятью: участок выдается общей DelayLineArena движка.
+ * Сброс clearLazily() - O(1): старые отсчеты обнуляются по мере того, как
+ * до них доходят чтения, для этого перед каждым блоком вызывается
+ * prepareBlock() с диапазоном задержек блока.
+ *
+ * Для рекурсивных фильтров с неизменной задержкой M есть блочный режим
+ * processInChunks(): на участке не длиннее M сэмплов ни одно чтение не
+ * зависит от записи того же участка, поэтому участок можно считать
+ * векторно вдоль времени.
+ */
+class DelayLine
+{
+public:
+    //==============================================================================
+    // Запас емкости сверх максимальной задержки для соседних точек интерполяции
+    static constexpr int interpolationHeadroom = 4;
+
+    // Минимальная задержка, при которой блочный режим выгоднее посэмплового
+    static constexpr int minimumChunkLength = 8;
+
+    DelayLine() = default;
+
+    //==============================================================================
+    // Выделение памяти (вне аудио-потока): участок резервируется в арене,
+    // линия получает его при DelayLineArena::commit()
+    void setMaximumDelay(int maxDelaySamples, DelayLineArena& arena)
+    {
+        const size_t capacity = capacityFor(maxDelaySamples);
+        arena.reserve(capacity, [this, capacity] (float* memory) { attach(memory, capacity); });
+    }
+
+    void attach(float* memory, size_t capacity)
+    {
+        jassert(juce::isPowerOfTwo(capacity));
+
+        buffer = memory;
+        mask = static_cast<std::uint32_t>(capacity - 1);
+        writeIndex = 0;
+        lazyClear.cancel();
+    }
+
+    // Немедленная очистка всей емкости
+    void clear()
+    {
+        if (buffer != nullptr)
+            std::fill(buffer, buffer + getCapacity(), 0.0f);
+
+        writeIndex = 0;
+        lazyClear.cancel();
+    }
+
+    // Сброс за O(1): история считается нулевой, реальное обнуление - в prepareBlock()
+    void clearLazily() noexcept
+    {
+        if (buffer == nullptr)
+            return;
+
+        writeIndex = 0;
+        lazyClear.markCleared(writeIndex);
+    }
+
+    // Перед блоком из numSamples записей с задержками чтения в [nearestDelay, farthestDelay].
+    // Учитываются соседние точки интерполяции: на сэмпл ближе и на headroom дальше
+    inline void prepareBlock(float nearestDelay, float farthestDelay, int numSamples) noexcept
+    {
+        lazyClear.prepareBlock(buffer, mask, static_cast<int>(nearestDelay) - 1,
+                               static_cast<int>(farthestDelay) + interpolationHeadroom, numSamples);
+    }
+
+    //==============================================================================
+    size_t getCapacity() const { return static_cast<size_t>(mask) + 1; }
+    int getMaximumDelay() const { return static_cast<int>(getCapacity()) - interpolationHeadroom; }
+
+    //==============================================================================
+    // Запись текущего сэмпла
+    inline void push(float sample) noexcept
+    {
+        buffer[writeIndex] = sample;
+        writeIndex = (writeIndex + 1u) & mask;
+    }
+
+    // Чтение с целой задержкой
+    inline float read(int delaySamples) const noexcept
+    {
+        return buffer[(writeIndex - static_cast<size_t>(delaySamples)) & mask];
+    }
+
+    // Чтение с дробной задержкой (линейная интерполяция, без ветвлений)
+    inline float readLinear(float delaySamples) const noexcept
+    {
+        const int integerDelay = static_cast<int>(delaySamples);
+        const float fraction = delaySamples - static_cast<float>(integerDelay);
+
+        const float newer = buffer[(writeIndex - static_cast<size_t>(integerDelay)) & mask];
+        const float older = buffer[(writeIndex - static_cast<size_t>(integerDelay) - 1) & mask];
+
+        return newer + fraction * (older - newer);
+    }
+
+    // Чтение ближайшего целого отсчета
+    inline float readNearest(float delaySamples) const noexcept
+    {
+        return read(static_cast<int>(delaySamples + 0.5f));
+    }
+
+    // 4-точечная интерполяция Эрмита; требует задержку >= 2 сэмплов
+    inline float readHermite(float delaySamples) const noexcept
+    {
+        const int integerDelay = static_cast<int>(delaySamples);
+        const float fraction = delaySamples - static_cast<float>(integerDelay);
+        const size_t newest = writeIndex - static_cast<size_t>(integerDelay);
+
+        const float xm1 = buffer[(newest + 1) & mask];
+        const float x0 = buffer[newest & mask];
+        const float x1 = buffer[(newest - 1) & mask];
+        const float x2 = buffer[(newest - 2) & mask];
+
+        const float c1 = 0.5f * (x1 - xm1);
+        const float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+        const float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+
+        return ((c3 * fraction + c2) * fraction + c1) * fraction + x0;
+    }
+
+    // All-pass интерполятор Тирана 1-го порядка: y = a*x[n] + x[n-1] - a*y[n-1].
+    // Дробная часть берется из [0.5, 1.5) - там фазовая задержка почти постоянна.
+    // state - предыдущий выход, должен вызываться каждый сэмпл
+    inline float readThiran(float delaySamples, float& state) const noexcept
+    {
+        const int integerDelay = static_cast<int>(delaySamples - 0.5f);
+        const float fraction = delaySamples - static_cast<float>(integerDelay);
+        const float a = (1.0f - fraction) / (1.0f + fraction);
+
+        const float newer = buffer[(writeIndex - static_cast<size_t>(integerDelay)) & mask];
+        const float older = buffer[(writeIndex - static_cast<size_t>(integerDelay) - 1) & mask];
+
+        state = a * (newer - state) + older;
+        return state;
+    }
+
+    // Чтение выбранного качества; режим - параметр шаблона, ветвления нет
+    template <InterpolationMode Mode>
+    inline float readInterpolated(float delaySamples, float& state) const noexcept
+    {
+        juce::ignoreUnused(state);
+
+        if constexpr (Mode == InterpolationMode::None)
+            return readNearest(delaySamples);
+        else if constexpr (Mode == InterpolationMode::Linear)
+            return readLinear(delaySamples);
+        else if constexpr (Mode == InterpolationMode::Hermite)
+            return readHermite(delaySamples);
+        else
+            return readThiran(delaySamples, state);
+    }
+
+    //==============================================================================
+    // Блочный режим: делит numSamples на участки, не превышающие задержку и не
+    // пересекающие конец буфера, и для каждого вызывает
+    // process(const float* delayed, float* write, int offset, int count).
+    // delayed - сэмплы с задержкой delaySamples, write - куда записать новые.
+    template <typename ChunkFunction>
+    inline void processInChunks(int delaySamples, int numSamples, ChunkFunction&& process) noexcept
+    {
+        const size_t capacity = getCapacity();
+        int offset = 0;
+
+        while (offset < numSamples)
+        {
+            const size_t readIndex = (writeIndex - static_cast<size_t>(delaySamples)) & mask;
+
+            size_t count = static_cast<size_t>(juce::jmin(numSamples - offset, delaySamples));
+            count = juce::jmin(count, capacity - readIndex);
+            count = juce::jmin(count, capacity - writeIndex);
+
+            process(buffer + readIndex, buffer + writeIndex, offset, static_cast<int>(count));
+
+            writeIndex = static_cast<std::uint32_t>((writeIndex + count) & mask);
+            offset += static_cast<int>(count);
+        }
+    }
+
+    //==============================================================================
+    // Один шаг плавного изменения задержки к цели. В пределах 0.1 сэмпла задержка
+    // фиксируется ровно на цели, чтобы после перехода снова работало целое чтение.
+    static inline float stepDelayGlide(float currentDelay, float targetDelay, float changeRate) noexcept
+    {
+        float next = currentDelay + changeRate;
+
+        // Защита от переполнения
+        if ((changeRate > 0.0f && next > targetDelay) || (changeRate < 0.0f && next < targetDelay)
+            || std::abs(next - targetDelay) <= 0.1f)
+            next = targetDelay;
+
+        return next;
+    }
+
+    // Кроссфейд отводов: position в [0, 1] -> усиления старого и нового отводов.
+    // Отводы стоят внутри петли обратной связи и коррелированы, поэтому
+    // усиления дают в сумме 1 (равномощный закон поднял бы усиление петли
+    // до sqrt(2) в середине перехода). Форма - sin^2 с нулевым наклоном на
+    // концах; sin(pi/2 * x) - ряд Тейлора до x^9, без sin/cos на каждый сэмпл
+    static inline void crossfadeGains(float position, float& fadeOut, float& fadeIn) noexcept
+    {
+        const float x2 = position * position;
+        const float quarterSine = position * (1.5707963f - x2 * (0.6459641f - x2 * (0.0796926f - x2 * (0.0046818f - x2 * 0.0001604f))));
+
+        fadeIn = quarterSine * quarterSine;
+        fadeOut = 1.0f - fadeIn;
+    }
+
+private:
+    //==============================================================================
+    static size_t capacityFor(int maxDelaySamples)
+    {
+        const int required = juce::jmax(1, maxDelaySamples) + interpolationHeadroom;
+        return static_cast<size_t>(juce::nextPowerOfTwo(required));
+    }
+
+    float* buffer = nullptr;     // Участок в DelayLineArena
+    std::uint32_t mask = 0;      // Емкость линии заведомо меньше 2^32
+    std::uint32_t writeIndex = 0;
+    LazyClear lazyClear;         // Состояние ленивого сброса, проверяется раз в блок
+};
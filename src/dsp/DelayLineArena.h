@@ -0,0 +1,151 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include "AlignedBuffer.h"
+
+#if defined(__linux__)
+ #include <sys/mman.h>
+#endif
+
+/**
+ * @brief Общая память линий задержки одного движка
+ *
+ * Вместо отдельного std::vector на каждую линию все линии движка
+ * нарезаются из одного непрерывного блока: comb, all-pass, pre-delay и
+ * ранние отражения лежат рядом, каждый участок начинается с границы
+ * 64 байт (кэш-линия / AVX-512). Несколько экземпляров плагина на одном
+ * ядре трогают меньше страниц и TLB-записей.
+ *
+ * Выделение двухфазное (вне аудио-потока): владельцы линий резервируют
+ * участки через reserve(), затем commit() выделяет блок и раздает адреса.
+ * Зарезервировавший объект не должен перемещаться до commit(). Если новая
+ * раскладка помещается в уже выделенный блок, commit() только обнуляет
+ * его - повторный prepare() не возвращает память системе.
+ *
+ * На Linux блок от hugePageSize байт берется через mmap и помечается
+ * MADV_HUGEPAGE - ядро может отдать его страницами по 2 МБ.
+ */
+class DelayLineArena
+{
+public:
+    //==============================================================================
+    DelayLineArena() = default;
+    ~DelayLineArena() { release(); }
+
+    //==============================================================================
+    // Начало раскладки: предыдущие резервы забываются, память пока не меняется
+    void beginLayout()
+    {
+        pending.clear();
+        layoutFloats = 0;
+    }
+
+    // Резерв участка; attach получит адрес участка при commit()
+    void reserve(size_t numFloats, std::function<void(float*)> attach)
+    {
+        pending.push_back({ layoutFloats, std::move(attach) });
+        layoutFloats += AlignedBuffer::roundUpToAlignment(juce::jmax(static_cast<size_t>(1), numFloats));
+    }
+
+    // Выделение блока под все резервы, память обнулена
+    void commit(bool useHugePages = true)
+    {
+        if (base != nullptr && layoutFloats <= numFloats && (usingHugePages || ! useHugePages))
+        {
+            std::fill(base, base + numFloats, 0.0f);
+        }
+        else
+        {
+            release();
+
+            if (layoutFloats > 0)
+                allocate(layoutFloats, useHugePages);
+        }
+
+        for (auto& slot : pending)
+            slot.attach(base + slot.offset);
+
+        pending.clear();
+    }
+
+    //==============================================================================
+    size_t getSizeInBytes() const { return numFloats * sizeof(float); }
+    bool isUsingHugePages() const { return usingHugePages; }
+
+private:
+    //==============================================================================
+    static constexpr size_t hugePageSize = 2 * 1024 * 1024;
+
+    struct Slot
+    {
+        size_t offset = 0;
+        std::function<void(float*)> attach;
+    };
+
+    void allocate(size_t floats, bool useHugePages)
+    {
+        numFloats = floats;
+        const size_t bytes = floats * sizeof(float);
+
+       #if defined(__linux__)
+        if (useHugePages && bytes >= hugePageSize)
+        {
+            // Запас в одну большую страницу, чтобы начало совпало с ее границей
+            const size_t mappedSize = (bytes + hugePageSize - 1) / hugePageSize * hugePageSize + hugePageSize;
+            void* region = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+            if (region != MAP_FAILED)
+            {
+                auto address = reinterpret_cast<std::uintptr_t>(region);
+                auto aligned = (address + hugePageSize - 1) / hugePageSize * hugePageSize;
+
+                madvise(reinterpret_cast<void*>(aligned), mappedSize - (aligned - address), MADV_HUGEPAGE);
+
+                mappedRegion = region;
+                mappedBytes = mappedSize;
+                base = reinterpret_cast<float*>(aligned);   // Анонимные страницы уже обнулены
+                usingHugePages = true;
+                return;
+            }
+        }
+       #else
+        juce::ignoreUnused(useHugePages, bytes);
+       #endif
+
+        heapStorage.allocate(floats);
+        base = heapStorage.get();
+    }
+
+    void release()
+    {
+       #if defined(__linux__)
+        if (mappedRegion != nullptr)
+            munmap(mappedRegion, mappedBytes);
+
+        mappedRegion = nullptr;
+        mappedBytes = 0;
+       #endif
+
+        heapStorage.release();
+        base = nullptr;
+        numFloats = 0;
+        usingHugePages = false;
+    }
+
+    std::vector<Slot> pending;
+    size_t layoutFloats = 0;
+
+    AlignedBuffer heapStorage;
+   #if defined(__linux__)
+    void* mappedRegion = nullptr;
+    size_t mappedBytes = 0;
+   #endif
+    float* base = nullptr;
+    size_t numFloats = 0;
+    bool usingHugePages = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DelayLineArena)
+};
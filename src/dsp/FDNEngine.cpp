@@ -0,0 +1,527 @@
+#include "FDNEngine.h"
+#include "utils/MathUtils.h"
+#include "SimdOps.h"
+#include <algorithm>
+#include <cmath>
+
+//==============================================================================
+FDNEngine::FDNEngine() = default;
+
+FDNEngine::~FDNEngine() = default;
+
+void FDNEngine::prepare(double sampleRate, int blockSize)
+{
+    const int newOrder = normaliseOrder(params.order);
+    const bool layoutChanged = ! isPrepared || sampleRate != this->sampleRate;
+    const bool orderChanged = newOrder != order;
+
+    this->sampleRate = sampleRate;
+    this->blockSize = blockSize;
+    order = newOrder;
+    params.order = order;
+    requestedOrder.store(order);
+
+    // Память линий выделяется под максимальный размер комнаты и maxOrder -
+    // ни roomSize, ни порядок во время воспроизведения не перераспределяют
+    // буферы. При той же частоте линии и их состояние сохраняются
+    if (layoutChanged)
+        allocateDelayLines();
+    else if (orderChanged)
+        reset();
+
+    isPrepared = true;
+
+    updateDelayTimes();
+    updateDamping();
+    updateInputOutputGains();
+    updateStereoMixing();
+
+    scratch.prepare(numScratchBuffers, blockSize);
+}
+
+void FDNEngine::reset()
+{
+    // Память не заполняется целиком: старые кадры обнуляются в processNetwork()
+    writePosition = 0;
+    lazyClear.markCleared(writePosition);
+    dampingState.fill(0.0f);
+}
+
+//==============================================================================
+void FDNEngine::process(const float* input, float* output, int numSamples)
+{
+    if (!isPrepared)
+    {
+        std::copy(input, input + numSamples, output);
+        return;
+    }
+
+    applyRequestedOrder();
+
+    // Моно путь: сеть та же, но считается одна выходная проекция
+    for (int offset = 0; offset < numSamples; offset += blockSize)
+    {
+        const int samplesThisTime = std::min(blockSize, numSamples - offset);
+        processMonoBlock(input + offset, output + offset, samplesThisTime);
+    }
+}
+
+void FDNEngine::processStereo(const float* inputL, const float* inputR,
+                              float* outputL, float* outputR, int numSamples)
+{
+    if (!isPrepared)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            outputL[i] = inputL[i];
+            outputR[i] = inputR[i];
+        }
+        return;
+    }
+
+    applyRequestedOrder();
+
+    // Арена рассчитана на blockSize сэмплов - более длинный блок режем на части
+    for (int offset = 0; offset < numSamples; offset += blockSize)
+    {
+        const int samplesThisTime = std::min(blockSize, numSamples - offset);
+        processStereoBlock(inputL + offset, inputR + offset,
+                           outputL + offset, outputR + offset, samplesThisTime);
+    }
+}
+
+void FDNEngine::processMonoBlock(const float* input, float* output, int numSamples)
+{
+    ScratchArena::ScopedFrame frame(scratch);
+
+    float* reverb = scratch.allocate(numSamples);
+
+    if (matrix.load(std::memory_order_relaxed) == MatrixType::Hadamard)
+        processNetwork<MatrixType::Hadamard, false>(input, reverb, nullptr, numSamples);
+    else
+        processNetwork<MatrixType::Householder, false>(input, reverb, nullptr, numSamples);
+
+    // Среднее стерео микса: (wetL + wetR) / 2 = reverbMono * (wet1 + wet2)
+    const float wetGain = wet1 + wet2;
+
+    for (int i = 0; i < numSamples; ++i)
+        output[i] = input[i] * dry + reverb[i] * wetGain;
+}
+
+void FDNEngine::processStereoBlock(const float* inputL, const float* inputR,
+                                   float* outputL, float* outputR, int numSamples)
+{
+    ScratchArena::ScopedFrame frame(scratch);
+
+    float* monoInput = scratch.allocate(numSamples);
+    float* reverbL = scratch.allocate(numSamples);
+    float* reverbR = scratch.allocate(numSamples);
+
+    for (int i = 0; i < numSamples; ++i)
+        monoInput[i] = (inputL[i] + inputR[i]) * 0.5f;
+
+    // Тип матрицы выбирается один раз на блок, а не на каждый сэмпл
+    if (matrix.load(std::memory_order_relaxed) == MatrixType::Hadamard)
+        processNetwork<MatrixType::Hadamard, true>(monoInput, reverbL, reverbR, numSamples);
+    else
+        processNetwork<MatrixType::Householder, true>(monoInput, reverbL, reverbR, numSamples);
+
+    // Финальное микширование стерео (как в ReverbEngine)
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float wetL = reverbL[i] * wet1 + reverbR[i] * wet2;
+        float wetR = reverbR[i] * wet1 + reverbL[i] * wet2;
+
+        outputL[i] = inputL[i] * dry + wetL;
+        outputR[i] = inputR[i] * dry + wetR;
+    }
+}
+
+template <FDNEngine::MatrixType Matrix, bool Stereo>
+void FDNEngine::processNetwork(const float* monoInput, float* reverbL, float* reverbR, int numSamples)
+{
+    using namespace SimdOps;
+
+    const Vec dampingVec = broadcast(dampingCoefficient);
+    float* memory = delayMemory.data();
+    const size_t stride = static_cast<size_t>(order);
+
+    // После reset() - обнуление кадров, до которых дотянутся чтения блока
+    if (lazyClear.isPending())
+    {
+        const auto range = std::minmax_element(delaySamples.begin(), delaySamples.begin() + order);
+        lazyClear.prepareBlock(memory, delayMask, *range.first, *range.second, numSamples, order);
+    }
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        // Чтение выходов всех линий (gather из чередованной памяти)
+        for (int line = 0; line < order; ++line)
+        {
+            const size_t position = (writePosition - static_cast<size_t>(delaySamples[line])) & delayMask;
+            delayed[line] = memory[position * stride + static_cast<size_t>(line)];
+        }
+
+        // Выходные проекции, one-pole lowpass и затухание за проход - по всем дорожкам сразу
+        Vec accL = broadcast(0.0f);
+        Vec accR = broadcast(0.0f);
+
+        for (int line = 0; line < order; line += width)
+        {
+            const Vec d = load(&delayed[line]);
+
+            if constexpr (Stereo)
+            {
+                accL = add(accL, mul(d, load(&outputGainL[line])));
+                accR = add(accR, mul(d, load(&outputGainR[line])));
+            }
+            else
+            {
+                accL = add(accL, mul(d, load(&outputGainMono[line])));
+            }
+
+            // lp[n] = d[n] + a * (lp[n-1] - d[n])
+            const Vec lowpass = add(d, mul(dampingVec, sub(load(&dampingState[line]), d)));
+            store(&dampingState[line], lowpass);
+            store(&feedback[line], mul(lowpass, load(&lineGain[line])));
+        }
+
+        reverbL[i] = SimdOps::sum(accL);
+
+        if constexpr (Stereo)
+            reverbR[i] = SimdOps::sum(accR);
+
+        // Унитарная матрица обратной связи
+        if constexpr (Matrix == MatrixType::Hadamard)
+            applyHadamard(feedback.data(), order);
+        else
+            applyHouseholder(feedback.data(), order);
+
+        // Запись кадра: обратная связь + вход, одна векторная запись на регистр
+        float* frame = memory + writePosition * stride;
+        const Vec x = broadcast(monoInput[i]);
+
+        for (int line = 0; line < order; line += width)
+            storeUnaligned(frame + line, add(load(&feedback[line]), mul(x, load(&inputGain[line]))));
+
+        writePosition = (writePosition + 1) & delayMask;
+    }
+}
+
+//==============================================================================
+// Быстрые матрицы обратной связи
+//==============================================================================
+
+void FDNEngine::applyHadamard(float* data, int size)
+{
+    using namespace SimdOps;
+
+    // Быстрое преобразование Уолша-Адамара: log2(N) проходов бабочек.
+    // Начиная с шага width обе половины бабочки - выровненные регистры
+    for (int half = 1; half < size; half *= 2)
+    {
+        for (int start = 0; start < size; start += 2 * half)
+        {
+            int j = start;
+
+            if (half >= width)
+            {
+                for (; j + width <= start + half; j += width)
+                {
+                    const Vec a = load(data + j);
+                    const Vec b = load(data + j + half);
+                    store(data + j, add(a, b));
+                    store(data + j + half, sub(a, b));
+                }
+            }
+
+            for (; j < start + half; ++j)
+            {
+                const float a = data[j];
+                const float b = data[j + half];
+                data[j] = a + b;
+                data[j + half] = a - b;
+            }
+        }
+    }
+
+    // Нормализация 1/sqrt(N) делает матрицу ортогональной (без потерь)
+    const Vec scale = broadcast(1.0f / std::sqrt(static_cast<float>(size)));
+    for (int j = 0; j < size; j += width)
+        store(data + j, mul(load(data + j), scale));
+}
+
+void FDNEngine::applyHouseholder(float* data, int size)
+{
+    using namespace SimdOps;
+
+    // A = I - (2/N) * 11^T: вычитаем из каждой дорожки удвоенное среднее
+    Vec acc = load(data);
+    for (int j = width; j < size; j += width)
+        acc = add(acc, load(data + j));
+
+    const Vec reflection = broadcast(SimdOps::sum(acc) * 2.0f / static_cast<float>(size));
+    for (int j = 0; j < size; j += width)
+        store(data + j, sub(load(data + j), reflection));
+}
+
+//==============================================================================
+// Параметры
+//==============================================================================
+
+void FDNEngine::setParameters(const Parameters& newParams)
+{
+    params = newParams;
+    params.order = normaliseOrder(newParams.order);
+
+    // Новый порядок сеть примет в начале следующего блока
+    requestedOrder.store(params.order);
+    matrix.store(params.matrix, std::memory_order_relaxed);
+
+    if (isPrepared)
+    {
+        updateDelayTimes();
+        updateDamping();
+        updateStereoMixing();
+    }
+}
+
+void FDNEngine::setRoomSize(float roomSizeM2)
+{
+    float oldRoomSize = params.roomSize;
+    params.roomSize = MathUtils::clamp(roomSizeM2, 10.0f, 10000.0f);
+
+    if (isPrepared && oldRoomSize != params.roomSize)
+        updateDelayTimes();
+}
+
+void FDNEngine::setDecayTime(float decayTimeSeconds)
+{
+    params.decayTime = MathUtils::clamp(decayTimeSeconds, 0.1f, 20.0f);
+    if (isPrepared)
+        updateDecay();
+}
+
+void FDNEngine::setDamping(float dampingPercent)
+{
+    params.damping = MathUtils::clamp(dampingPercent, 0.0f, 100.0f);
+    if (isPrepared)
+        updateDamping();
+}
+
+void FDNEngine::setStereoWidth(float widthPercent)
+{
+    params.stereoWidth = MathUtils::clamp(widthPercent, 0.0f, 150.0f);
+    if (isPrepared)
+        updateStereoMixing();
+}
+
+void FDNEngine::setDryWetMix(float mixPercent)
+{
+    params.dryWetMix = juce::jlimit(0.0f, 100.0f, mixPercent);
+    if (isPrepared)
+        updateStereoMixing();
+}
+
+void FDNEngine::setOrder(int newOrder)
+{
+    // Память уже рассчитана на maxOrder: порядок переключает аудио-поток
+    params.order = normaliseOrder(newOrder);
+    requestedOrder.store(params.order);
+}
+
+void FDNEngine::setMatrixType(MatrixType newMatrix)
+{
+    // Обе матрицы ортогональны - переключение не требует пересчета усилений,
+    // аудио-поток подхватит матрицу со следующего блока
+    params.matrix = newMatrix;
+    matrix.store(newMatrix, std::memory_order_relaxed);
+}
+
+//==============================================================================
+// Внутренние методы
+//==============================================================================
+
+void FDNEngine::allocateDelayLines()
+{
+    // Самые длинные задержки получаются при максимальном roomSize; емкость -
+    // под самую длинную линию любого порядка, кадр - под maxOrder линий
+    int maxDelay = 1;
+
+    for (int candidateOrder = 8; candidateOrder <= maxOrder; candidateOrder *= 2)
+    {
+        DelayLengths longest {};
+        getDelayLengths(candidateOrder, calculateRoomScale(10000.0f), sampleRate, longest);
+        maxDelay = juce::jmax(maxDelay, *std::max_element(longest.begin(), longest.begin() + candidateOrder));
+    }
+
+    const size_t capacity = static_cast<size_t>(juce::nextPowerOfTwo(maxDelay + 1));
+    delayMemory.assign(capacity * static_cast<size_t>(maxOrder), 0.0f);
+    delayMask = capacity - 1;
+    writePosition = 0;
+    lazyClear.cancel();
+
+    lineGain.fill(0.0f);
+    dampingState.fill(0.0f);
+    inputGain.fill(0.0f);
+    outputGainL.fill(0.0f);
+    outputGainR.fill(0.0f);
+    outputGainMono.fill(0.0f);
+    delayed.fill(0.0f);
+    feedback.fill(0.0f);
+    delaySamples.fill(1);
+}
+
+void FDNEngine::applyRequestedOrder() noexcept
+{
+    const int newOrder = requestedOrder.load(std::memory_order_relaxed);
+
+    if (newOrder == order)
+        return;
+
+    // Память не перераспределяется: кадры той же емкости читаются с новым
+    // шагом, поэтому сеть начинается с тишины, как после reset()
+    order = newOrder;
+    updateDelayTimes();
+    updateInputOutputGains();
+
+    feedback.fill(0.0f);
+    delayed.fill(0.0f);
+    reset();
+}
+
+void FDNEngine::updateDelayTimes()
+{
+    // Таблица на стеке фиксированного размера: сеттеры не выделяют память
+    DelayLengths lengths {};
+    getDelayLengths(order, calculateRoomScale(params.roomSize), sampleRate, lengths);
+    const int maxDelay = static_cast<int>(delayMask);
+
+    for (int line = 0; line < order; ++line)
+        delaySamples[line] = MathUtils::clamp(lengths[static_cast<size_t>(line)], 1, maxDelay);
+
+    // Затухание за проход зависит от длины линии
+    updateDecay();
+}
+
+void FDNEngine::updateDecay()
+{
+    // g_i = 10^(-3 * M_i / (T60 * fs)): каждая линия теряет 60 дБ за decayTime
+    const double samplesPerDecay = static_cast<double>(params.decayTime) * sampleRate;
+
+    for (int line = 0; line < order; ++line)
+        lineGain[line] = static_cast<float>(std::pow(10.0, -3.0 * delaySamples[line] / samplesPerDecay));
+}
+
+void FDNEngine::updateDamping()
+{
+    // Коэффициент one-pole lowpass в петле: 0 - без затухания ВЧ, 0.7 - сильное
+    float dampingNormalized = MathUtils::clamp(params.damping / 100.0f, 0.0f, 1.0f);
+    dampingCoefficient = dampingNormalized * 0.7f;
+}
+
+void FDNEngine::updateInputOutputGains()
+{
+    // Знакопеременные векторы входа и выходов: равномерное возбуждение сети
+    // без попадания в собственный вектор матрицы, L и R декоррелированы
+    const float scale = 1.0f / std::sqrt(static_cast<float>(order));
+
+    for (int line = 0; line < order; ++line)
+    {
+        inputGain[line] = ((line * 5 + 1) & 2) ? -scale : scale;
+        outputGainL[line] = (line & 1) ? -scale : scale;
+        outputGainR[line] = (line & 2) ? -scale : scale;
+        outputGainMono[line] = (outputGainL[line] + outputGainR[line]) * 0.5f;
+    }
+}
+
+void FDNEngine::updateStereoMixing()
+{
+    // Freeverb-style стерео микширование (как в ReverbEngine)
+    float effectMix = params.dryWetMix / 100.0f;  // 0-1
+    float width = params.stereoWidth / 100.0f;    // 0-1.5
+
+    float wetTotal = effectMix;
+    float dryTotal = 1.0f - effectMix;
+
+    // Стерео ширина влияет на cross-mixing
+    wet1 = wetTotal * (width / 2.0f + 0.5f);
+    wet2 = wetTotal * (1.0f - width) / 2.0f;
+    dry = dryTotal;
+
+    wet1 = MathUtils::clamp(wet1, 0.0f, 1.0f);
+    wet2 = MathUtils::clamp(wet2, 0.0f, 1.0f);
+    dry = MathUtils::clamp(dry, 0.0f, 1.0f);
+
+    // Общая нормализация для предотвращения перегруза
+    float totalGain = wet1 + wet2 + dry;
+    if (totalGain > 1.0f)
+    {
+        wet1 /= totalGain;
+        wet2 /= totalGain;
+        dry /= totalGain;
+    }
+}
+
+//==============================================================================
+// Времена задержек
+//==============================================================================
+
+void FDNEngine::getDelayLengths(int order, float roomScale, double sampleRate, DelayLengths& lengths)
+{
+    // Геометрический ряд 17-53 мс для средней комнаты: длины равномерно
+    // покрывают диапазон в логарифмическом масштабе, что дает ровную
+    // плотность мод. Затем каждая длина сдвигается к ближайшему свободному
+    // простому числу - все длины попарно взаимно просты.
+    const double shortestMs = 17.0;
+    const double longestMs = 53.0;
+
+    for (int line = 0; line < order; ++line)
+    {
+        const double position = order > 1 ? static_cast<double>(line) / (order - 1) : 0.0;
+        const double delayMs = shortestMs * std::pow(longestMs / shortestMs, position) * roomScale;
+
+        int candidate = juce::jmax(2, static_cast<int>(delayMs * 0.001 * sampleRate));
+
+        while (!isPrime(candidate)
+               || std::find(lengths.begin(), lengths.begin() + line, candidate) != lengths.begin() + line)
+            ++candidate;
+
+        lengths[static_cast<size_t>(line)] = candidate;
+    }
+}
+
+float FDNEngine::calculateRoomScale(float roomSize)
+{
+    // Та же кубическая модель, что и в ReverbEngine:
+    // 10m² → 0.2x, 1000m² → 1.0x, 10000m² → 2.15x
+    float scale = 0.2f + 0.8f * std::pow(roomSize / 1000.0f, 0.33f);
+    return MathUtils::clamp(scale, 0.2f, 2.5f);
+}
+
+bool FDNEngine::isPrime(int value)
+{
+    if (value < 2)
+        return false;
+
+    if (value % 2 == 0)
+        return value == 2;
+
+    for (int divisor = 3; divisor * divisor <= value; divisor += 2)
+        if (value % divisor == 0)
+            return false;
+
+    return true;
+}
+
+int FDNEngine::normaliseOrder(int requestedOrder)
+{
+    // Порядок - степень двойки (нужно для Адамара) и кратен ширине SIMD
+    if (requestedOrder <= 8)
+        return 8;
+
+    if (requestedOrder <= 16)
+        return 16;
+
+    return maxOrder;
+}
@@ -1,4 +1,5 @@
 #include "FFTEngine.h"
+#include "FFTPlanCache.h"
 #include "utils/MathUtils.h"
 #include <algorithm>
 
@@ -27,7 +28,8 @@ void FFTEngine::prepare(int fftSize, double sampleRate)
 {
     this->fftSize = fftSize;
     this->sampleRate = sampleRate;
-    this->hopSize = static_cast<int>(fftSize * params.overlap);
+    params.fftSize = fftSize;
+    this->hopSize = computeHopSize();
     
     // Инициализация FFT
     initializeFFT();
@@ -44,14 +46,46 @@ void FFTEngine::prepare(int fftSize, double sampleRate)
 void FFTEngine::reset()
 {
     // Очистка буферов
-    std::fill(fftBuffer.begin(), fftBuffer.end(), 0.0f);
-    std::fill(fftSpectrum.begin(), fftSpectrum.end(), std::complex<float>(0.0f, 0.0f));
+    if (fftBuffer != nullptr)
+    {
+        std::fill(fftBuffer.get(), fftBuffer.get() + fftSize, 0.0f);
+        std::fill(fftSpectrum.get(), fftSpectrum.get() + getNumBins(), std::complex<float>(0.0f, 0.0f));
+    }
+
+    std::fill(inputBuffer.begin(), inputBuffer.end(), 0.0f);
     std::fill(outputBuffer.begin(), outputBuffer.end(), 0.0f);
     std::fill(overlapBuffer.begin(), overlapBuffer.end(), 0.0f);
     
     outputIndex = 0;
 }
 
+//==============================================================================
+FFTEngine::RealBuffer FFTEngine::allocateRealBuffer(int numSamples)
+{
+    const auto count = static_cast<size_t>(juce::jmax(1, numSamples));
+    RealBuffer buffer(fftwf_alloc_real(count));
+
+    if (buffer == nullptr)
+        throw std::bad_alloc();
+
+    std::fill(buffer.get(), buffer.get() + count, 0.0f);
+    return buffer;
+}
+
+FFTEngine::SpectrumBuffer FFTEngine::allocateSpectrumBuffer(int numBins)
+{
+    const auto count = static_cast<size_t>(juce::jmax(1, numBins));
+
+    // std::complex<float> совместим по раскладке с fftwf_complex (float[2])
+    SpectrumBuffer buffer(reinterpret_cast<std::complex<float>*>(fftwf_alloc_complex(count)));
+
+    if (buffer == nullptr)
+        throw std::bad_alloc();
+
+    std::fill(buffer.get(), buffer.get() + count, std::complex<float>(0.0f, 0.0f));
+    return buffer;
+}
+
 //==============================================================================
 void FFTEngine::performForwardFFT(const float* input, std::complex<float>* output)
 {
@@ -59,22 +93,23 @@ void FFTEngine::performForwardFFT(const float* input, std::complex<float>* outpu
         return;
     
     // Копирование входных данных
-    std::copy(input, input + fftSize, fftBuffer.data());
+    std::copy(input, input + fftSize, fftBuffer.get());
     
     // Применение окна
-    applyWindowToBuffer(fftBuffer.data(), window);
+    applyWindowToBuffer(fftBuffer.get(), window);
     
-    // Выполнение FFT (заглушка)
-    // В реальной реализации:
-    // fftwf_execute(fftPlan);
+    // Выполнение FFT: буферы плана, результат копируется - выход может быть невыровненным
+    forwardTransform(fftBuffer.get(), fftSpectrum.get());
     
-    // Копирование результата
-    std::copy(fftSpectrum.begin(), fftSpectrum.end(), output);
+    // Копирование результата (половина спектра)
+    const int numBins = getNumBins();
+    std::copy(fftSpectrum.get(), fftSpectrum.get() + numBins, output);
     
-    // Нормализация если включена
+    // Нормализация если включена: 1/sqrt(fftSize) здесь и в обратном -
+    // прямое+обратное дают исходный сигнал
     if (params.normalize)
     {
-        normalizeSpectrum(output, fftSize);
+        normalizeSpectrum(output, numBins, fftSize);
     }
 }
 
@@ -83,32 +118,51 @@ void FFTEngine::performInverseFFT(const std::complex<float>* input, float* outpu
     if (!isPrepared)
         return;
     
-    // Копирование входных данных
-    std::copy(input, input + fftSize, fftSpectrum.data());
+    // Копирование входных данных: c2r портит вход, спектр вызывающего не трогаем
+    std::copy(input, input + getNumBins(), fftSpectrum.get());
     
-    // Выполнение IFFT (заглушка)
-    // В реальной реализации:
-    // fftwf_execute(ifftPlan);
+    // Выполнение IFFT
+    inverseTransform(fftSpectrum.get(), fftBuffer.get());
     
-    // Копирование результата
-    std::copy(fftBuffer.begin(), fftBuffer.begin() + fftSize, output);
+    // Копирование результата с нормировкой: FFTW не нормирует, прямое+обратное = N
+    const float scale = params.normalize ? 1.0f / std::sqrt(static_cast<float>(fftSize))
+                                         : 1.0f / static_cast<float>(fftSize);
+
+    for (int i = 0; i < fftSize; ++i)
+    {
+        output[i] = fftBuffer[static_cast<size_t>(i)] * scale;
+    }
     
     // Применение окна синтеза
     applyWindowToBuffer(output, synthesisWindow);
 }
 
+void FFTEngine::forwardTransform(float* input, std::complex<float>* spectrum) noexcept
+{
+    // New-array execute допустим только для буферов с выравниванием плана
+    jassert(fftPlan != nullptr);
+    jassert(hasPlanAlignment(input) && hasPlanAlignment(reinterpret_cast<const float*>(spectrum)));
+
+    fftwf_execute_dft_r2c(fftPlan, input, reinterpret_cast<fftwf_complex*>(spectrum));
+}
+
+void FFTEngine::inverseTransform(std::complex<float>* spectrum, float* output) noexcept
+{
+    jassert(ifftPlan != nullptr);
+    jassert(hasPlanAlignment(output) && hasPlanAlignment(reinterpret_cast<const float*>(spectrum)));
+
+    fftwf_execute_dft_c2r(ifftPlan, reinterpret_cast<fftwf_complex*>(spectrum), output);
+}
+
 void FFTEngine::performSTFT(const float* input, std::complex<float>* output, int frameIndex)
 {
     if (!isPrepared)
         return;
     
-    // Заглушка для STFT
-    // В реальной реализации:
-    // 1. Извлечение кадра с учетом hop size
-    // 2. Применение окна
-    // 3. Выполнение FFT
+    // Кадр с учетом hop size, окно анализа и FFT
+    analyseFrame(input + static_cast<size_t>(frameIndex) * static_cast<size_t>(hopSize));
     
-    std::fill(output, output + fftSize, std::complex<float>(0.0f, 0.0f));
+    std::copy(frameSpectrum.get(), frameSpectrum.get() + getNumBins(), output);
 }
 
 void FFTEngine::performISTFT(const std::complex<float>* input, float* output, int frameIndex)
@@ -116,13 +170,62 @@ void FFTEngine::performISTFT(const std::complex<float>* input, float* output, in
     if (!isPrepared)
         return;
     
-    // Заглушка для ISTFT
-    // В реальной реализации:
-    // 1. Выполнение IFFT
-    // 2. Применение окна синтеза
-    // 3. Overlap-add в выходной буфер
+    // IFFT, окно синтеза и overlap-add в выходной буфер
+    std::copy(input, input + getNumBins(), frameSpectrum.get());
     
-    std::fill(output, output + fftSize, 0.0f);
+    synthesiseFrame(output + static_cast<size_t>(frameIndex) * static_cast<size_t>(hopSize));
+}
+
+//==============================================================================
+void FFTEngine::exchangeSamples(const float* input, float* output, int numSamples) noexcept
+{
+    // Вход - в хвост кадра, выход - из готового hop (вход читается первым: in-place)
+    std::copy(input, input + numSamples, inputBuffer.data() + (fftSize - hopSize + outputIndex));
+    std::copy(outputBuffer.data() + outputIndex, outputBuffer.data() + outputIndex + numSamples, output);
+    
+    outputIndex += numSamples;
+}
+
+void FFTEngine::analyseFrame(const float* frame) noexcept
+{
+    float* buffer = frameBuffer.get();
+    
+    for (int i = 0; i < fftSize; ++i)
+    {
+        buffer[i] = frame[i] * window[static_cast<size_t>(i)];
+    }
+    
+    forwardTransform(buffer, frameSpectrum.get());
+}
+
+void FFTEngine::synthesiseFrame(float* destination) noexcept
+{
+    float* buffer = frameBuffer.get();
+    
+    inverseTransform(frameSpectrum.get(), buffer);
+    
+    // c2r не нормирует: 1/N вместе с окном синтеза
+    const float scale = 1.0f / static_cast<float>(fftSize);
+    
+    for (int i = 0; i < fftSize; ++i)
+    {
+        destination[i] += buffer[i] * (synthesisWindow[static_cast<size_t>(i)] * scale);
+    }
+}
+
+void FFTEngine::finishFrame() noexcept
+{
+    synthesiseFrame(overlapBuffer.data());
+    
+    // Первый hop накопителя больше не получит вкладов - он становится выходом
+    std::copy(overlapBuffer.begin(), overlapBuffer.begin() + hopSize, outputBuffer.begin());
+    std::copy(overlapBuffer.begin() + hopSize, overlapBuffer.end(), overlapBuffer.begin());
+    std::fill(overlapBuffer.end() - hopSize, overlapBuffer.end(), 0.0f);
+    
+    // Кадр сдвигается на hop, освобождая место под новый вход
+    std::copy(inputBuffer.begin() + hopSize, inputBuffer.end(), inputBuffer.begin());
+    
+    outputIndex = 0;
 }
 
 //==============================================================================
@@ -130,46 +233,50 @@ void FFTEngine::setParameters(const Parameters& newParams)
 {
     params = newParams;
     
-    // Обновление FFT размера если изменился
+    // Обновление FFT размера если изменился: новые планы
     if (params.fftSize != fftSize)
     {
-        cleanupFFT();
+        fftSize = params.fftSize;
         initializeFFT();
     }
     
     // Обновление hop size
-    hopSize = static_cast<int>(params.fftSize * params.overlap);
+    hopSize = computeHopSize();
     
-    // Обновление окон
+    // Обновление окон; поток STFT начинается заново (вызывается вне аудио-потока)
     initializeWindows();
+    initializeBuffers();
 }
 
 //==============================================================================
-void FFTEngine::createWindow(std::vector<float>& window, int size, int type)
+void FFTEngine::createWindow(std::vector<float>& window, int size, int type, bool periodic)
 {
     window.resize(size);
     
+    // Периодическое окно - симметричное длины size + 1 без последнего отсчета
+    const int period = periodic ? size : size - 1;
+    
     switch (type)
     {
         case 0: // Hann
             for (int i = 0; i < size; ++i)
             {
-                window[i] = 0.5f - 0.5f * MathUtils::fastCos(MathUtils::TWO_PI * i / (size - 1));
+                window[i] = 0.5f - 0.5f * MathUtils::fastCos(MathUtils::TWO_PI * i / period);
             }
             break;
             
         case 1: // Hamming
             for (int i = 0; i < size; ++i)
             {
-                window[i] = 0.54f - 0.46f * MathUtils::fastCos(MathUtils::TWO_PI * i / (size - 1));
+                window[i] = 0.54f - 0.46f * MathUtils::fastCos(MathUtils::TWO_PI * i / period);
             }
             break;
             
         case 2: // Blackman
             for (int i = 0; i < size; ++i)
             {
-                window[i] = 0.42f - 0.5f * MathUtils::fastCos(MathUtils::TWO_PI * i / (size - 1)) + 
-                            0.08f * MathUtils::fastCos(2.0f * MathUtils::TWO_PI * i / (size - 1));
+                window[i] = 0.42f - 0.5f * MathUtils::fastCos(MathUtils::TWO_PI * i / period) + 
+                            0.08f * MathUtils::fastCos(2.0f * MathUtils::TWO_PI * i / period);
             }
             break;
             
@@ -177,7 +284,7 @@ void FFTEngine::createWindow(std::vector<float>& window, int size, int type)
             // По умолчанию Hann
             for (int i = 0; i < size; ++i)
             {
-                window[i] = 0.5f - 0.5f * MathUtils::fastCos(MathUtils::TWO_PI * i / (size - 1));
+                window[i] = 0.5f - 0.5f * MathUtils::fastCos(MathUtils::TWO_PI * i / period);
             }
             break;
     }
@@ -222,16 +329,25 @@ void FFTEngine::setMagnitudeAndPhase(std::complex<float>* spectrum, const float*
 //==============================================================================
 void FFTEngine::initializeFFT()
 {
-    // Создание FFT планов (заглушка)
-    // В реальной реализации:
-    // fftPlan = fftwf_plan_dft_r2c_1d(fftSize, fftBuffer.data(), 
-    //                                 reinterpret_cast<fftwf_complex*>(fftSpectrum.data()), FFTW_ESTIMATE);
-    // ifftPlan = fftwf_plan_dft_c2r_1d(fftSize, reinterpret_cast<fftwf_complex*>(fftSpectrum.data()), 
-    //                                  fftBuffer.data(), FFTW_ESTIMATE);
-    
-    // Инициализация буферов
-    fftBuffer.resize(fftSize);
-    fftSpectrum.resize(fftSize);
+    cleanupFFT();
+
+    // Буферы плана: fftSize отсчетов и половина спектра
+    fftBuffer = allocateRealBuffer(fftSize);
+    fftSpectrum = allocateSpectrumBuffer(getNumBins());
+    frameBuffer = allocateRealBuffer(fftSize);
+    frameSpectrum = allocateSpectrumBuffer(getNumBins());
+
+    // Измеренные планы общие на процесс: повторный prepare() и другие
+    // экземпляры того же размера получают готовый план из реестра
+    auto& planCache = FFTPlanCache::getInstance();
+    const int alignment = fftwf_alignment_of(fftBuffer.get());
+
+    jassert(alignment == fftwf_alignment_of(reinterpret_cast<float*>(fftSpectrum.get())));
+
+    fftPlan = planCache.getPlan(fftSize, FFTPlanCache::Direction::RealToComplex, alignment);
+    ifftPlan = planCache.getPlan(fftSize, FFTPlanCache::Direction::ComplexToReal, alignment);
+
+    jassert(fftPlan != nullptr && ifftPlan != nullptr);
 }
 
 void FFTEngine::initializeWindows()
@@ -239,27 +355,52 @@ void FFTEngine::initializeWindows()
     window.resize(fftSize);
     synthesisWindow.resize(fftSize);
     
-    // Создание окон
-    createWindow(window, fftSize, params.windowType);
-    createWindow(synthesisWindow, fftSize, params.windowType);
+    // Окно анализа периодическое
+    createWindow(window, fftSize, params.windowType, true);
+    
+    // Окно синтеза WOLA: w[n] / сумма w^2 по всем кадрам, накрывающим отсчет.
+    // Тогда сумма окна анализа на окно синтеза по перекрытию равна единице
+    // при любом типе окна и hop - восстановление без модуляции амплитуды
+    for (int n = 0; n < fftSize; ++n)
+    {
+        double overlapSum = 0.0;
+        
+        for (int m = n % hopSize; m < fftSize; m += hopSize)
+        {
+            overlapSum += static_cast<double>(window[m]) * window[m];
+        }
+        
+        synthesisWindow[n] = overlapSum > 0.0 ? static_cast<float>(window[n] / overlapSum) : 0.0f;
+    }
 }
 
 void FFTEngine::initializeBuffers()
 {
     // Overlap-add буферы
-    outputBuffer.resize(fftSize * 2);
+    inputBuffer.resize(fftSize);
+    outputBuffer.resize(fftSize);
     overlapBuffer.resize(fftSize);
     
     // Инициализация
+    std::fill(inputBuffer.begin(), inputBuffer.end(), 0.0f);
     std::fill(outputBuffer.begin(), outputBuffer.end(), 0.0f);
     std::fill(overlapBuffer.begin(), overlapBuffer.end(), 0.0f);
     
     outputIndex = 0;
 }
 
-void FFTEngine::normalizeSpectrum(std::complex<float>* spectrum, int numBins)
+int FFTEngine::computeHopSize() const
+{
+    // overlap - доля перекрытия кадров, hop - оставшаяся часть кадра
+    const int hop = static_cast<int>(std::lround(fftSize * (1.0f - params.overlap)));
+    
+    return juce::jlimit(1, fftSize, hop);
+}
+
+void FFTEngine::normalizeSpectrum(std::complex<float>* spectrum, int numBins, int transformSize)
 {
-    float scale = 1.0f / std::sqrt(static_cast<float>(numBins));
+    // Масштаб - по длине преобразования, а не по числу хранимых бинов
+    float scale = 1.0f / std::sqrt(static_cast<float>(transformSize));
     
     for (int i = 0; i < numBins; ++i)
     {
@@ -267,6 +408,13 @@ void FFTEngine::normalizeSpectrum(std::complex<float>* spectrum, int numBins)
     }
 }
 
+bool FFTEngine::hasPlanAlignment(const float* data) const noexcept
+{
+    // fftwf_alignment_of принимает неконстантный указатель, но данные не читает
+    return fftwf_alignment_of(const_cast<float*>(data))
+        == fftwf_alignment_of(fftBuffer.get());
+}
+
 void FFTEngine::applyWindowToBuffer(float* buffer, const std::vector<float>& window)
 {
     if (buffer == nullptr || window.empty())
@@ -282,11 +430,7 @@ void FFTEngine::applyWindowToBuffer(float* buffer, const std::vector<float>& win
 
 void FFTEngine::cleanupFFT()
 {
-    // Очистка FFTW планов (заглушка)
-    // В реальной реализации:
-    // if (fftPlan) fftwf_destroy_plan(fftPlan);
-    // if (ifftPlan) fftwf_destroy_plan(ifftPlan);
-    
+    // Планами владеет FFTPlanCache, здесь только отпускаем ссылки
     fftPlan = nullptr;
     ifftPlan = nullptr;
 } 
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <vector>
 #include <complex>
+#include <memory>
 #include <fftw3.h>
 
 /**
@@ -10,6 +11,13 @@
  * 
  * Обертка над FFTW3 библиотекой для выполнения FFT и IFFT операций.
  * Поддерживает различные размеры FFT и оптимизирована для реального времени.
+ *
+ * Преобразования вещественные (r2c/c2r): спектр хранится половиной -
+ * getNumBins() = fftSize/2 + 1 комплексных отсчетов, остальные бины
+ * сопряжены с ними. Планы берутся в prepare() из FFTPlanCache и исполняются
+ * через new-array execute (fftwf_execute_dft_r2c/c2r), поэтому один план
+ * обслуживает любые буферы с тем же выравниванием, что у буферов
+ * allocateRealBuffer()/allocateSpectrumBuffer() (fftwf_malloc).
  */
 class FFTEngine
 {
@@ -24,23 +32,76 @@ public:
     void reset();
 
     //==============================================================================
-    // FFT операции
+    // Буферы, выровненные fftwf_malloc (под SIMD FFTW), заполнены нулями
+    struct FFTWDeleter
+    {
+        void operator()(void* data) const noexcept { fftwf_free(data); }
+    };
+
+    using RealBuffer = std::unique_ptr<float[], FFTWDeleter>;
+    using SpectrumBuffer = std::unique_ptr<std::complex<float>[], FFTWDeleter>;
+
+    static RealBuffer allocateRealBuffer(int numSamples);
+    static SpectrumBuffer allocateSpectrumBuffer(int numBins);
+
+    //==============================================================================
+    // FFT операции: fftSize отсчетов <-> getNumBins() бинов, с окном и нормализацией
     void performForwardFFT(const float* input, std::complex<float>* output);
     void performInverseFFT(const std::complex<float>* input, float* output);
+
+    // Голые преобразования на выровненных буферах вызывающего, без окна и
+    // нормализации. Обратное не нормировано (результат в fftSize раз больше)
+    // и, как любое c2r в FFTW, портит входной спектр. Без аллокаций.
+    void forwardTransform(float* input, std::complex<float>* spectrum) noexcept;
+    void inverseTransform(std::complex<float>* spectrum, float* output) noexcept;
     
-    // STFT операции
+    // STFT операции по кадрам сигнала целиком: кадр frameIndex начинается
+    // с отсчета frameIndex * hopSize. performSTFT дает спектр кадра с окном
+    // анализа, performISTFT прибавляет кадр с окном синтеза к output -
+    // сумма всех кадров восстанавливает сигнал (WOLA).
     void performSTFT(const float* input, std::complex<float>* output, int frameIndex);
     void performISTFT(const std::complex<float>* input, float* output, int frameIndex);
 
+    //==============================================================================
+    // Потоковый STFT для блоков любого размера. Каждые hopSize сэмплов
+    // вызывается processSpectrum(spectrum, numBins) со спектром очередного
+    // кадра (окно анализа, без нормировки); спектр можно менять на месте,
+    // результат уходит в overlap-add. Выход задержан на getLatencySamples().
+    // input и output могут совпадать. Без аллокаций после prepare().
+    template <typename SpectralFunction>
+    void processSTFT(const float* input, float* output, int numSamples, SpectralFunction&& processSpectrum)
+    {
+        if (! isPrepared)
+            return;
+
+        for (int done = 0; done < numSamples;)
+        {
+            const int count = juce::jmin(numSamples - done, hopSize - outputIndex);
+
+            exchangeSamples(input + done, output + done, count);
+            done += count;
+
+            if (outputIndex == hopSize)
+            {
+                analyseFrame(inputBuffer.data());
+                processSpectrum(frameSpectrum.get(), getNumBins());
+                finishFrame();
+            }
+        }
+    }
+
+    // Кадр завершается, только когда последний его сэмпл уже выдан
+    int getLatencySamples() const { return fftSize; }
+
     //==============================================================================
     // Параметры
     struct Parameters
     {
         int fftSize = 2048;              // размер FFT (512, 1024, 2048, 4096)
-        int hopSize = 512;               // размер hop (обычно fftSize/4)
+        int hopSize = 512;               // размер hop: вычисляется из overlap
         int windowType = 0;              // 0=Hanning, 1=Hamming, 2=Blackman
-        float overlap = 0.75f;           // overlap factor (0.5-0.9)
-        bool normalize = true;           // нормализация FFT
+        float overlap = 0.75f;           // overlap factor (0.5-0.9): hop = fftSize * (1 - overlap)
+        bool normalize = true;           // 1/sqrt(N) в обе стороны; иначе 1/N только в обратном
     };
 
     void setParameters(const Parameters& newParams);
@@ -49,11 +110,12 @@ public:
     //==============================================================================
     // Утилиты
     int getFFTSize() const { return fftSize; }
+    int getNumBins() const { return fftSize / 2 + 1; }
     int getHopSize() const { return hopSize; }
     double getSampleRate() const { return sampleRate; }
     
-    // Окна
-    void createWindow(std::vector<float>& window, int size, int type);
+    // Окна: симметричные или периодические (для STFT - COLA при целом числе hop на кадр)
+    void createWindow(std::vector<float>& window, int size, int type, bool periodic = false);
     void applyWindow(float* buffer, int size);
     
     // Магнитуда и фаза
@@ -71,29 +133,42 @@ private:
     double sampleRate = 44100.0;
     bool isPrepared = false;
 
-    // FFTW планы
+    // FFTW планы (r2c и c2r размера fftSize) из общего FFTPlanCache
     fftwf_plan fftPlan = nullptr;
     fftwf_plan ifftPlan = nullptr;
     
-    // Буферы
-    std::vector<float> fftBuffer;
-    std::vector<std::complex<float>> fftSpectrum;
-    std::vector<float> window;
-    std::vector<float> synthesisWindow;
+    // Буферы, на которых строились планы: fftSize отсчетов и getNumBins() бинов
+    RealBuffer fftBuffer;
+    SpectrumBuffer fftSpectrum;
+    std::vector<float> window;              // Окно анализа (периодическое)
+    std::vector<float> synthesisWindow;     // Окно синтеза, нормированное под WOLA
     
-    // Overlap-add буферы
-    std::vector<float> outputBuffer;
-    std::vector<float> overlapBuffer;
-    int outputIndex = 0;
+    // Кадр STFT: отдельно от буферов performForwardFFT, выравнивание как у плана
+    RealBuffer frameBuffer;
+    SpectrumBuffer frameSpectrum;
+
+    // Overlap-add буферы потокового STFT (по fftSize сэмплов)
+    std::vector<float> inputBuffer;         // Последние fftSize входных сэмплов, новый hop - в хвосте
+    std::vector<float> outputBuffer;        // Готовый hop выхода, выдается по мере прихода входа
+    std::vector<float> overlapBuffer;       // Накопитель overlap-add, начало - следующий hop
+    int outputIndex = 0;                    // Позиция внутри текущего hop
 
     //==============================================================================
     // Внутренние методы
     void initializeFFT();
     void initializeWindows();
     void initializeBuffers();
+    int computeHopSize() const;
+
+    // Потоковый STFT
+    void exchangeSamples(const float* input, float* output, int numSamples) noexcept;
+    void analyseFrame(const float* frame) noexcept;
+    void synthesiseFrame(float* destination) noexcept;
+    void finishFrame() noexcept;
     
     // Утилиты
-    void normalizeSpectrum(std::complex<float>* spectrum, int numBins);
+    void normalizeSpectrum(std::complex<float>* spectrum, int numBins, int transformSize);
+    bool hasPlanAlignment(const float* data) const noexcept;
     void applyWindowToBuffer(float* buffer, const std::vector<float>& window);
     
     // Очистка ресурсов
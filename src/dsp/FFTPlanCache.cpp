@@ -0,0 +1,109 @@
+#include "FFTPlanCache.h"
+#include <memory>
+
+//==============================================================================
+FFTPlanCache& FFTPlanCache::getInstance()
+{
+    static FFTPlanCache instance;
+    return instance;
+}
+
+FFTPlanCache::FFTPlanCache()
+    : wisdomFile(juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+                     .getChildFile("Spreadra")
+                     .getChildFile("fftwf-wisdom.txt"))
+{
+    loadWisdom();
+}
+
+FFTPlanCache::~FFTPlanCache()
+{
+    std::lock_guard<std::mutex> lock(plannerLock);
+
+    for (auto& entry : plans)
+        fftwf_destroy_plan(entry.second);
+
+    plans.clear();
+}
+
+//==============================================================================
+fftwf_plan FFTPlanCache::getPlan(int fftSize, Direction direction, int alignment)
+{
+    const Key key { fftSize, direction, alignment };
+
+    std::lock_guard<std::mutex> lock(plannerLock);
+
+    auto found = plans.find(key);
+
+    if (found != plans.end())
+        return found->second;
+
+    // Сначала только из мудрости; измерение и запись файла - лишь для нового размера
+    auto* plan = createPlan(key, FFTW_MEASURE | FFTW_WISDOM_ONLY);
+
+    if (plan == nullptr)
+    {
+        plan = createPlan(key, FFTW_MEASURE);
+
+        if (plan != nullptr)
+            saveWisdom();
+    }
+
+    if (plan != nullptr)
+        plans.emplace(key, plan);
+
+    return plan;
+}
+
+juce::File FFTPlanCache::getWisdomFile() const
+{
+    return wisdomFile;
+}
+
+//==============================================================================
+fftwf_plan FFTPlanCache::createPlan(const Key& key, unsigned flags)
+{
+    // FFTW_MEASURE перезаписывает массивы при планировании, поэтому план
+    // строится на собственных буферах, сдвинутых до нужного выравнивания
+    struct Deleter { void operator()(float* data) const noexcept { fftwf_free(data); } };
+
+    const int numBins = key.fftSize / 2 + 1;
+    const int offset = key.alignment / static_cast<int>(sizeof(float));
+    const int padding = 16;     // Запас под сдвиг: выравнивание FFTW не больше 64 байт
+
+    std::unique_ptr<float, Deleter> realStorage(fftwf_alloc_real(static_cast<size_t>(key.fftSize + padding)));
+    std::unique_ptr<float, Deleter> complexStorage(fftwf_alloc_real(static_cast<size_t>(2 * numBins + padding)));
+
+    if (realStorage == nullptr || complexStorage == nullptr)
+        return nullptr;
+
+    float* real = realStorage.get() + offset;
+    auto* spectrum = reinterpret_cast<fftwf_complex*>(complexStorage.get() + offset);
+
+    jassert(fftwf_alignment_of(real) == key.alignment);
+
+    if (key.direction == Direction::RealToComplex)
+        return fftwf_plan_dft_r2c_1d(key.fftSize, real, spectrum, flags);
+
+    return fftwf_plan_dft_c2r_1d(key.fftSize, spectrum, real, flags);
+}
+
+//==============================================================================
+void FFTPlanCache::loadWisdom()
+{
+    // Отсутствующий или чужой файл не ошибка: планы просто будут измерены заново
+    if (wisdomFile.existsAsFile())
+        fftwf_import_wisdom_from_filename(wisdomFile.getFullPathName().toRawUTF8());
+}
+
+void FFTPlanCache::saveWisdom()
+{
+    if (! wisdomFile.getParentDirectory().createDirectory())
+        return;
+
+    // Несколько процессов хоста могут писать одновременно - замена целиком
+    juce::TemporaryFile temporary(wisdomFile);
+
+    if (fftwf_export_wisdom_to_filename(temporary.getFile().getFullPathName().toRawUTF8()) != 0)
+        temporary.overwriteTargetFileWithTemporary();
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <fftw3.h>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+/**
+ * @brief Общий на процесс реестр планов FFTW с сохраняемой мудростью
+ *
+ * Планы строятся с FFTW_MEASURE один раз на процесс для каждого сочетания
+ * размера, направления и выравнивания буферов и разделяются всеми
+ * экземплярами FFTEngine: план неизменяем, а исполнение через
+ * fftwf_execute_dft_r2c/c2r с новыми массивами потокобезопасно.
+ *
+ * Планировщик и мудрость FFTW - глобальное состояние без защиты, поэтому
+ * все обращения к ним идут под одной блокировкой реестра. Мудрость
+ * читается из файла в кэше пользователя при первом обращении к реестру
+ * и перезаписывается (атомарно, через временный файл) после каждого
+ * измерения: со второго запуска планы строятся из мудрости без измерений.
+ */
+class FFTPlanCache
+{
+public:
+    //==============================================================================
+    enum class Direction
+    {
+        RealToComplex,      // fftSize отсчетов -> fftSize/2 + 1 бинов
+        ComplexToReal       // обратно, без нормировки, портит вход
+    };
+
+    static FFTPlanCache& getInstance();
+
+    //==============================================================================
+    // План для буферов с выравниванием alignment (fftwf_alignment_of) у входа
+    // и выхода. Потокобезопасно; план живет до выгрузки модуля. Вызывается
+    // вне аудио-потока: первый план нового размера измеряется.
+    fftwf_plan getPlan(int fftSize, Direction direction, int alignment);
+
+    // Файл мудрости (по умолчанию - в папке данных пользователя)
+    juce::File getWisdomFile() const;
+
+private:
+    //==============================================================================
+    FFTPlanCache();
+    ~FFTPlanCache();
+
+    struct Key
+    {
+        int fftSize;
+        Direction direction;
+        int alignment;
+
+        bool operator<(const Key& other) const noexcept
+        {
+            return std::tie(fftSize, direction, alignment)
+                 < std::tie(other.fftSize, other.direction, other.alignment);
+        }
+    };
+
+    fftwf_plan createPlan(const Key& key, unsigned flags);
+    void loadWisdom();
+    void saveWisdom();
+
+    //==============================================================================
+    std::mutex plannerLock;
+    std::map<Key, fftwf_plan> plans;
+    juce::File wisdomFile;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FFTPlanCache)
+};
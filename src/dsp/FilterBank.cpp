@@ -23,16 +23,23 @@ FilterBank::~FilterBank()
 }
 
 //==============================================================================
-void FilterBank::prepare(double sampleRate, int blockSize)
+void FilterBank::prepare(double sampleRate, int maxHostBlockSize)
 {
+    // Арена рассчитана на один микро-блок, блок хоста на память не влияет
+    juce::ignoreUnused(maxHostBlockSize);
+    
+    // При той же частоте коэффициенты и состояние фильтров остаются прежними
+    const bool sampleRateChanged = ! isPrepared || sampleRate != this->sampleRate;
+    
     this->sampleRate = sampleRate;
-    this->blockSize = blockSize;
+    this->blockSize = MicroBlock::size;
     
     // Инициализация фильтров
-    initializeFilters();
+    if (sampleRateChanged)
+        initializeFilters();
     
-    // Инициализация временных буферов
-    tempBuffer.resize(blockSize);
+    // Инициализация арены временных буферов
+    scratch.prepare(numScratchBuffers, blockSize);
     
     isPrepared = true;
 }
@@ -46,13 +53,14 @@ void FilterBank::reset()
     if (allPassFilter) allPassFilter->reset();
     
     // Очистка временных буферов
-    std::fill(tempBuffer.begin(), tempBuffer.end(), 0.0f);
+    scratch.reset();
 }
 
 //==============================================================================
 void FilterBank::process(const float* input, float* output, int numSamples)
 {
-    if (!isPrepared || numSamples > blockSize)
+    // Посэмпловая обработка без временных буферов - размер блока не ограничен
+    if (!isPrepared)
         return;
     
     // Копирование входного сигнала
@@ -99,21 +107,35 @@ void FilterBank::processStereo(const float* inputL, const float* inputR,
     // Проблема: оба канала используют одни и те же фильтры
     // Решение: Обрабатываем как МОНО, затем копируем на оба канала
     
-    // Создаем моно сигнал (среднее L+R)
-    std::vector<float> monoInput(numSamples);
-    std::vector<float> monoOutput(numSamples);
+    if (!isPrepared)
+        return;
+    
+    MicroBlock::forEach(numSamples, [&] (int offset, int count)
+    {
+        processStereoMicroBlock(inputL + offset, inputR + offset,
+                                outputL + offset, outputR + offset, count);
+    });
+}
+
+void FilterBank::processStereoMicroBlock(const float* inputL, const float* inputR,
+                                         float* outputL, float* outputR, int numSamples)
+{
+    ScratchArena::ScopedFrame frame(scratch);
+    float* monoInput = scratch.allocate(numSamples);
+    float* monoOutput = scratch.allocate(numSamples);
     
+    // Создаем моно сигнал (среднее L+R)
     for (int i = 0; i < numSamples; ++i)
     {
         monoInput[i] = (inputL[i] + inputR[i]) * 0.5f;
     }
     
     // Обрабатываем как моно
-    process(monoInput.data(), monoOutput.data(), numSamples);
+    process(monoInput, monoOutput, numSamples);
     
     // Копируем результат на оба канала
-    std::copy(monoOutput.begin(), monoOutput.end(), outputL);
-    std::copy(monoOutput.begin(), monoOutput.end(), outputR);
+    std::copy(monoOutput, monoOutput + numSamples, outputL);
+    std::copy(monoOutput, monoOutput + numSamples, outputR);
 }
 
 //==============================================================================
@@ -201,11 +223,14 @@ void FilterBank::enableAllPass(bool enabled)
 //==============================================================================
 void FilterBank::initializeFilters()
 {
-    // Создание фильтров
-    lowPassFilter = std::make_unique<BiquadFilter>(BiquadFilter::Type::LowPass);
-    highPassFilter = std::make_unique<BiquadFilter>(BiquadFilter::Type::HighPass);
-    bandPassFilter = std::make_unique<BiquadFilter>(BiquadFilter::Type::BandPass);
-    allPassFilter = std::make_unique<BiquadFilter>(BiquadFilter::Type::AllPass);
+    // Создание фильтров - один раз, повторный prepare() только пересчитывает их
+    if (lowPassFilter == nullptr)
+    {
+        lowPassFilter = std::make_unique<BiquadFilter>(BiquadFilter::Type::LowPass);
+        highPassFilter = std::make_unique<BiquadFilter>(BiquadFilter::Type::HighPass);
+        bandPassFilter = std::make_unique<BiquadFilter>(BiquadFilter::Type::BandPass);
+        allPassFilter = std::make_unique<BiquadFilter>(BiquadFilter::Type::AllPass);
+    }
     
     // Подготовка фильтров
     lowPassFilter->prepare(sampleRate);
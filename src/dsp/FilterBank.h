@@ -2,6 +2,8 @@
 
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <vector>
+#include "ScratchArena.h"
+#include "MicroBlock.h"
 
 /**
  * @brief Банк фильтров для обработки сигнала
@@ -21,14 +23,14 @@ public:
     ~FilterBank();
 
     //==============================================================================
-    // Основная обработка
+    // Основная обработка: блок любого размера, стерео путь режется на микро-блоки
     void process(const float* input, float* output, int numSamples);
     void processStereo(const float* inputL, const float* inputR, 
                       float* outputL, float* outputR, int numSamples);
 
     //==============================================================================
     // Подготовка
-    void prepare(double sampleRate, int blockSize);
+    void prepare(double sampleRate, int maxHostBlockSize);
     void reset();
 
     //==============================================================================
@@ -124,7 +126,7 @@ private:
     // Состояние
     Parameters params;
     double sampleRate = 44100.0;
-    int blockSize = 512;
+    int blockSize = MicroBlock::size;
     bool isPrepared = false;
 
     // Фильтры
@@ -133,13 +135,16 @@ private:
     std::unique_ptr<BiquadFilter> bandPassFilter;
     std::unique_ptr<BiquadFilter> allPassFilter;
 
-    // Временные буферы
-    std::vector<float> tempBuffer;
+    // Временные буферы на один микро-блок - выдаются из арены
+    static constexpr int numScratchBuffers = 2;
+    ScratchArena scratch;
 
     //==============================================================================
     // Внутренние методы
     void initializeFilters();
     void updateFilterParameters();
+    void processStereoMicroBlock(const float* inputL, const float* inputR,
+                                 float* outputL, float* outputR, int numSamples);
 
     // JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FilterBank)
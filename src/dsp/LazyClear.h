@@ -0,0 +1,118 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <algorithm>
+#include <cstdint>
+
+/**
+ * @brief Ленивая очистка кольцевого буфера задержки
+ *
+ * Сброс за O(1): запоминается позиция, с которой продолжится запись, а все
+ * содержимое буфера считается нулем (владельцы, как и при обычной очистке,
+ * возвращают запись к началу - выход после сброса совпадает с выходом
+ * только что подготовленной линии). Буфер не заполняется целиком - перед каждым блоком
+ * владелец вызывает prepareBlock() с диапазоном задержек, которые блок
+ * прочитает, и зануляются только те старые отсчеты, до которых эти чтения
+ * дотянутся. Обнуление растягивается на следующие блоки (примерно по
+ * блоку на линию), горячие циклы чтения остаются без проверок.
+ *
+ * Глубина k - отсчет, записанный за k сэмплов до сброса. Обнуленные
+ * глубины образуют отрезок [zeroedNear, zeroedFar], который расширяется
+ * по мере надобности. Когда после сброса записана вся емкость, старых
+ * отсчетов в буфере больше нет и проверка отключается.
+ *
+ * Слот буфера - stride подряд идущих float (для чередованных линий FDN).
+ * Состояние - 16 байт: оно входит в DelayLine и не должно раздувать
+ * горячие записи фильтров (AllPassFilter - одна кэш-линия).
+ */
+class LazyClear
+{
+public:
+    //==============================================================================
+    // Сброс: история до позиции записи writeIndex считается нулевой
+    void markCleared(size_t writeIndex) noexcept
+    {
+        resetIndex = static_cast<std::uint32_t>(writeIndex);
+        samplesSinceReset = 0;
+        zeroedNear = 1;
+        zeroedFar = 0;      // Пустой отрезок
+    }
+
+    // История действительно обнулена (например, сразу после выделения)
+    void cancel() noexcept { samplesSinceReset = notPending; }
+
+    bool isPending() const noexcept { return samplesSinceReset != notPending; }
+
+    //==============================================================================
+    // Перед блоком из numSamples записей: чтения блока с задержками
+    // [nearestDelay, farthestDelay] от позиции записи не увидят старых данных
+    inline void prepareBlock(float* buffer, size_t mask, int nearestDelay, int farthestDelay,
+                             int numSamples, int stride = 1) noexcept
+    {
+        if (! isPending())
+            return;
+
+        const int capacity = static_cast<int>(mask + 1);
+
+        // Отсчет i блока с задержкой d читает глубину d - i - samplesSinceReset;
+        // глубины за capacity - samplesSinceReset уже перезаписаны новыми данными
+        const int deepest = juce::jmin(farthestDelay - samplesSinceReset, capacity - samplesSinceReset);
+        const int shallowest = juce::jmax(1, nearestDelay - (numSamples - 1) - samplesSinceReset);
+
+        if (deepest >= shallowest)
+        {
+            if (zeroedFar < zeroedNear)
+            {
+                zeroDepths(buffer, mask, shallowest, deepest, stride);
+                zeroedNear = shallowest;
+                zeroedFar = deepest;
+            }
+            else
+            {
+                if (shallowest < zeroedNear)
+                {
+                    zeroDepths(buffer, mask, shallowest, zeroedNear - 1, stride);
+                    zeroedNear = shallowest;
+                }
+
+                if (deepest > zeroedFar)
+                {
+                    zeroDepths(buffer, mask, zeroedFar + 1, deepest, stride);
+                    zeroedFar = deepest;
+                }
+            }
+        }
+
+        samplesSinceReset += numSamples;
+
+        if (samplesSinceReset >= capacity)
+            cancel();
+    }
+
+private:
+    //==============================================================================
+    // Обнуление глубин [near, far]: непрерывный участок буфера, возможно с переносом
+    void zeroDepths(float* buffer, size_t mask, int near, int far, int stride) noexcept
+    {
+        const size_t capacity = mask + 1;
+        size_t position = (static_cast<size_t>(resetIndex) - static_cast<size_t>(far)) & mask;
+        size_t remaining = static_cast<size_t>(far - near + 1);
+
+        while (remaining > 0)
+        {
+            const size_t count = std::min(remaining, capacity - position);
+            std::fill(buffer + position * static_cast<size_t>(stride),
+                      buffer + (position + count) * static_cast<size_t>(stride), 0.0f);
+
+            position = (position + count) & mask;
+            remaining -= count;
+        }
+    }
+
+    static constexpr int notPending = -1;
+
+    std::uint32_t resetIndex = 0;
+    int samplesSinceReset = notPending;
+    int zeroedNear = 1;
+    int zeroedFar = 0;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+
+/**
+ * @brief Нарезка блока хоста на микро-блоки фиксированного размера
+ *
+ * Хост может передать блок любого размера (офлайн-рендер - десятки тысяч
+ * сэмплов). Внутренняя обработка всегда идет микро-блоками по size
+ * сэмплов: арены временных буферов готовятся под один микро-блок и
+ * целиком помещаются в L1, а результат не зависит от размера блока хоста.
+ */
+namespace MicroBlock
+{
+    constexpr int size = 64;    // 256 байт на промежуточный буфер
+
+    // process(offset, count) для каждого микро-блока по порядку
+    template <typename ProcessFunction>
+    inline void forEach(int numSamples, ProcessFunction&& process)
+    {
+        for (int offset = 0; offset < numSamples; offset += size)
+            process(offset, juce::jmin(size, numSamples - offset));
+    }
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <array>
+#include "SimdOps.h"
+#include "DelayLineArena.h"
+#include "LazyClear.h"
+
+/**
+ * @brief Одна линия задержки с таблицей отводов (разреженный FIR)
+ *
+ * Ранние отражения - это один и тот же входной сигнал, прочитанный с
+ * разными задержками и усилениями. Вместо отдельного буфера на каждое
+ * отражение вход записывается один раз, а выход каждого канала считается
+ * по таблице отводов {задержка, gain}.
+ *
+ * Обработка блочная: сначала весь блок входа записывается в линию, затем
+ * для каждого отвода выход накапливает непрерывный участок линии,
+ * умноженный на gain - векторный axpy вдоль времени. Емкость линии
+ * рассчитана на maxDelay + maxBlockSize, поэтому запись блока не затирает
+ * сэмплы, которые еще нужны отводам.
+ *
+ * Задержка d читает x[n - d], минимальная задержка - 1 сэмпл.
+ * Память линии выдается общей DelayLineArena движка, сброс clearLazily() -
+ * O(1) (см. LazyClear).
+ */
+class MultiTapDelay
+{
+public:
+    //==============================================================================
+    static constexpr int maxOutputs = 2;
+    static constexpr int maxTaps = 16;
+
+    struct Tap
+    {
+        int delaySamples = 1;
+        float gain = 0.0f;
+    };
+
+    MultiTapDelay() = default;
+
+    //==============================================================================
+    // Выделение памяти (вне аудио-потока): участок резервируется в арене,
+    // линия получает его при DelayLineArena::commit()
+    void prepare(int maxDelaySamples, int maxBlockSize, int numOutputsToUse, DelayLineArena& arena)
+    {
+        jassert(numOutputsToUse > 0 && numOutputsToUse <= maxOutputs);
+
+        maxDelay = juce::jmax(1, maxDelaySamples);
+        maxBlock = juce::jmax(1, maxBlockSize);
+        numOutputs = juce::jlimit(1, maxOutputs, numOutputsToUse);
+
+        const size_t capacity = static_cast<size_t>(juce::nextPowerOfTwo(maxDelay + maxBlock));
+        arena.reserve(capacity, [this, capacity] (float* memory)
+        {
+            buffer = memory;
+            mask = capacity - 1;
+            writeIndex = 0;
+            lazyClear.cancel();
+        });
+
+        for (auto& outputTaps : taps)
+            outputTaps.fill(Tap());
+
+        numTaps.fill(0);
+    }
+
+    void clear()
+    {
+        if (buffer != nullptr)
+            std::fill(buffer, buffer + mask + 1, 0.0f);
+
+        writeIndex = 0;
+        lazyClear.cancel();
+    }
+
+    // Сброс за O(1): старые отсчеты обнуляются перед блоками, которые их читают
+    void clearLazily() noexcept
+    {
+        if (buffer == nullptr)
+            return;
+
+        writeIndex = 0;
+        lazyClear.markCleared(writeIndex);
+    }
+
+    //==============================================================================
+    // Таблица отводов: задержка ограничивается диапазоном, выделенным в prepare()
+    void setTap(int output, int tap, int delaySamples, float gain)
+    {
+        jassert(output >= 0 && output < numOutputs);
+        jassert(tap >= 0 && tap < maxTaps);
+
+        taps[output][tap] = { juce::jlimit(1, maxDelay, delaySamples), gain };
+        numTaps[output] = juce::jmax(numTaps[output], tap + 1);
+    }
+
+    void setNumTaps(int output, int count)
+    {
+        numTaps[output] = juce::jlimit(0, maxTaps, count);
+    }
+
+    int getNumTaps(int output) const { return numTaps[output]; }
+    int getNumOutputs() const { return numOutputs; }
+    int getMaximumDelay() const { return maxDelay; }
+    int getMaximumBlockSize() const { return maxBlock; }
+    const Tap& getTap(int output, int tap) const { return taps[output][tap]; }
+
+    //==============================================================================
+    // Обработка блока: один вход, по выходу на каждый набор отводов
+    void process(const float* input, float* const* outputs, int numSamples) noexcept
+    {
+        process(input, outputs, numSamples, numOutputs);
+    }
+
+    // Только первые numOutputsToProcess выходов (моно путь)
+    void process(const float* input, float* const* outputs, int numSamples, int numOutputsToProcess) noexcept
+    {
+        jassert(numSamples <= maxBlock);
+
+        const size_t capacity = mask + 1;
+        const size_t blockStart = writeIndex;
+        const int activeOutputs = juce::jlimit(1, numOutputs, numOutputsToProcess);
+
+        if (lazyClear.isPending())
+        {
+            int nearest = maxDelay;
+            int farthest = 0;
+
+            for (int output = 0; output < activeOutputs; ++output)
+            {
+                for (int tap = 0; tap < numTaps[output]; ++tap)
+                {
+                    nearest = juce::jmin(nearest, taps[output][tap].delaySamples);
+                    farthest = juce::jmax(farthest, taps[output][tap].delaySamples);
+                }
+            }
+
+            lazyClear.prepareBlock(buffer, mask, nearest, farthest, numSamples);
+        }
+
+        // Запись блока входа (с переносом через конец буфера)
+        const size_t firstPart = juce::jmin(static_cast<size_t>(numSamples), capacity - writeIndex);
+        std::copy(input, input + firstPart, buffer + writeIndex);
+        std::copy(input + firstPart, input + numSamples, buffer);
+        writeIndex = (writeIndex + static_cast<size_t>(numSamples)) & mask;
+
+        for (int output = 0; output < activeOutputs; ++output)
+        {
+            float* out = outputs[output];
+            std::fill(out, out + numSamples, 0.0f);
+
+            for (int tap = 0; tap < numTaps[output]; ++tap)
+            {
+                const Tap& t = taps[output][tap];
+                size_t readIndex = (blockStart - static_cast<size_t>(t.delaySamples)) & mask;
+                int offset = 0;
+
+                // Участки чтения не пересекают конец буфера
+                while (offset < numSamples)
+                {
+                    const int count = static_cast<int>(juce::jmin(static_cast<size_t>(numSamples - offset),
+                                                                  capacity - readIndex));
+                    accumulate(out + offset, buffer + readIndex, t.gain, count);
+
+                    readIndex = (readIndex + static_cast<size_t>(count)) & mask;
+                    offset += count;
+                }
+            }
+        }
+    }
+
+private:
+    //==============================================================================
+    // out[i] += gain * source[i]
+    static inline void accumulate(float* out, const float* source, float gain, int count) noexcept
+    {
+        using namespace SimdOps;
+
+        const Vec gainVec = broadcast(gain);
+        int i = 0;
+
+        for (; i + width <= count; i += width)
+            storeUnaligned(out + i, add(loadUnaligned(out + i), mul(gainVec, loadUnaligned(source + i))));
+
+        for (; i < count; ++i)
+            out[i] += gain * source[i];
+    }
+
+    float* buffer = nullptr;     // Участок в DelayLineArena
+    size_t mask = 0;
+    size_t writeIndex = 0;
+    LazyClear lazyClear;
+
+    int maxDelay = 1;
+    int maxBlock = 1;
+    int numOutputs = 1;
+
+    std::array<std::array<Tap, maxTaps>, maxOutputs> taps {};
+    std::array<int, maxOutputs> numTaps {};
+};
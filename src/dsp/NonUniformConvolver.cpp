@@ -0,0 +1,323 @@
+#include "NonUniformConvolver.h"
+#include "SimdOps.h"
+#include <algorithm>
+#include <chrono>
+
+//==============================================================================
+NonUniformConvolver::NonUniformConvolver() = default;
+
+NonUniformConvolver::~NonUniformConvolver()
+{
+    // Снятый набор удаляется вне аудио-потока: задание в полете дописывается
+    stopWorker();
+}
+
+void NonUniformConvolver::prepare(int numChannels, double sampleRate)
+{
+    const int newNumChannels = juce::jlimit(1, maxChannels, numChannels);
+
+    // При тех же параметрах сегменты и их состояние сохраняются
+    if (isPrepared && newNumChannels == this->numChannels && sampleRate == this->sampleRate)
+        return;
+
+    // Сегменты могут обходиться process() - другие параметры только у нового экземпляра
+    jassert(! isPrepared);
+
+    this->numChannels = newNumChannels;
+    this->sampleRate = sampleRate;
+
+    for (int channel = 0; channel < maxChannels; ++channel)
+    {
+        headHistory[static_cast<size_t>(channel)].assign(static_cast<size_t>(2 * headSize - 1), 0.0f);
+        syncConvolvers[static_cast<size_t>(channel)].prepare(headSize, sampleRate);
+        syncFifo[static_cast<size_t>(channel)].assign(static_cast<size_t>(headSize), 0.0f);
+    }
+
+    isPrepared = true;
+
+    reset();
+}
+
+void NonUniformConvolver::loadImpulseResponse(const float* const* channels, int numSamples)
+{
+    // Задания и process() держат указатели на сегменты - они строятся
+    // только в новом экземпляре, до запуска потока
+    jassert(isPrepared);
+    jassert(tailSegments.empty() && ! worker.isThreadRunning());
+
+    const int length = channels != nullptr ? juce::jmax(0, numSamples) : 0;
+
+    // Голова: коэффициенты в обратном порядке, чтобы свертка шла по возрастанию адресов
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        float* taps = headTaps[static_cast<size_t>(channel)].data();
+        std::fill(taps, taps + headSize, 0.0f);
+
+        for (int i = 0; i < juce::jmin(headSize, length); ++i)
+            taps[headSize - 1 - i] = channels[channel][i];
+    }
+
+    // Синхронный сегмент до 2B следующей (в growthFactor раз большей) части
+    int partitionSize = headSize;
+    int offset = headSize;
+    int end = juce::jmin(length, 2 * growthFactor * partitionSize);
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        syncConvolvers[static_cast<size_t>(channel)].loadImpulseResponse(
+            length > offset ? channels[channel] + offset : nullptr, juce::jmax(0, end - offset));
+    }
+
+    // Хвост: каждый сегмент начинается ровно со смещения 2B своей части
+    offset = juce::jmax(offset, end);
+
+    while (offset < length)
+    {
+        partitionSize *= growthFactor;
+        jassert(offset == 2 * partitionSize);
+
+        end = partitionSize < maxPartitionSize ? juce::jmin(length, 2 * growthFactor * partitionSize) : length;
+
+        auto segment = std::make_unique<TailSegment>();
+        segment->offset = offset;
+        segment->partitionSize = partitionSize;
+        segment->inputBlocks.assign(static_cast<size_t>(maxChannels * 2 * partitionSize), 0.0f);
+        segment->outputBlocks.assign(static_cast<size_t>(maxChannels * 2 * partitionSize), 0.0f);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto& convolver = segment->convolvers[static_cast<size_t>(channel)];
+            convolver.prepare(partitionSize, sampleRate);
+            convolver.loadImpulseResponse(channels[channel] + offset, end - offset);
+        }
+
+        tailSegments.push_back(std::move(segment));
+        offset = end;
+    }
+
+    reset();
+
+    if (! tailSegments.empty())
+        startWorker();
+}
+
+void NonUniformConvolver::reset()
+{
+    if (! isPrepared)
+        return;
+
+    // Задания в полете дописываются до очистки их буферов
+    for (auto& segment : tailSegments)
+        waitForJob(*segment);
+
+    for (int channel = 0; channel < maxChannels; ++channel)
+    {
+        std::fill(headHistory[static_cast<size_t>(channel)].begin(), headHistory[static_cast<size_t>(channel)].end(), 0.0f);
+        std::fill(syncFifo[static_cast<size_t>(channel)].begin(), syncFifo[static_cast<size_t>(channel)].end(), 0.0f);
+        syncConvolvers[static_cast<size_t>(channel)].reset();
+    }
+
+    for (auto& segment : tailSegments)
+    {
+        for (auto& convolver : segment->convolvers)
+            convolver.reset();
+
+        std::fill(segment->inputBlocks.begin(), segment->inputBlocks.end(), 0.0f);
+        std::fill(segment->outputBlocks.begin(), segment->outputBlocks.end(), 0.0f);
+        segment->currentSlot = 0;
+    }
+
+    samplesProcessed = 0;
+}
+
+//==============================================================================
+void NonUniformConvolver::process(const float* const* inputs, float* const* outputs,
+                                  int numChannels, int numSamples) noexcept
+{
+    const int activeChannels = juce::jmin(numChannels, this->numChannels);
+    const std::uint32_t headMask = static_cast<std::uint32_t>(headSize - 1);
+
+    // Границы всех частей кратны headSize - куски не пересекают ни одну
+    for (int done = 0; done < numSamples;)
+    {
+        const int headPosition = static_cast<int>(samplesProcessed & headMask);
+        const int count = juce::jmin(numSamples - done, headSize - headPosition);
+
+        for (int channel = 0; channel < activeChannels; ++channel)
+        {
+            // Копия входа: выход может указывать на тот же буфер
+            float input[headSize];
+            float* output = outputs[channel] + done;
+            std::copy(inputs[channel] + done, inputs[channel] + done + count, input);
+
+            processHead(channel, input, output, count);
+
+            float* fifo = syncFifo[static_cast<size_t>(channel)].data() + headPosition;
+
+            for (int i = 0; i < count; ++i)
+            {
+                output[i] += fifo[i];
+                fifo[i] = input[i];
+            }
+
+            for (auto& segment : tailSegments)
+            {
+                const int position = static_cast<int>(samplesProcessed & static_cast<std::uint32_t>(segment->partitionSize - 1));
+                float* inputBlock = segment->block(segment->inputBlocks, channel, segment->currentSlot) + position;
+                const float* outputBlock = segment->block(segment->outputBlocks, channel, segment->currentSlot) + position;
+
+                std::copy(input, input + count, inputBlock);
+
+                for (int i = 0; i < count; ++i)
+                    output[i] += outputBlock[i];
+            }
+        }
+
+        samplesProcessed += static_cast<std::uint32_t>(count);
+        done += count;
+
+        if ((samplesProcessed & headMask) != 0)
+            continue;
+
+        // Синхронный сегмент: часть набрана, свертка на месте
+        for (int channel = 0; channel < activeChannels; ++channel)
+        {
+            float* fifo = syncFifo[static_cast<size_t>(channel)].data();
+            syncConvolvers[static_cast<size_t>(channel)].process(fifo, fifo);
+        }
+
+        for (auto& segment : tailSegments)
+            if ((samplesProcessed & static_cast<std::uint32_t>(segment->partitionSize - 1)) == 0)
+                finishTailBlock(*segment, activeChannels);
+    }
+}
+
+void NonUniformConvolver::processHead(int channel, const float* input, float* output, int numSamples) noexcept
+{
+    using namespace SimdOps;
+
+    float* history = headHistory[static_cast<size_t>(channel)].data();
+    const float* taps = headTaps[static_cast<size_t>(channel)].data();
+
+    // history[headSize - 1 + i] - текущий сэмпл i, перед ним headSize - 1 прошлых
+    std::copy(input, input + numSamples, history + headSize - 1);
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        Vec acc = broadcast(0.0f);
+
+        for (int tap = 0; tap < headSize; tap += width)
+            acc = add(acc, mul(loadUnaligned(history + i + tap), load(taps + tap)));
+
+        output[i] = SimdOps::sum(acc);
+    }
+
+    std::copy(history + numSamples, history + numSamples + headSize - 1, history);
+}
+
+//==============================================================================
+void NonUniformConvolver::finishTailBlock(TailSegment& segment, int activeChannels) noexcept
+{
+    // Дедлайн: выход задания прошлого периода читается с этого сэмпла
+    waitForJob(segment);
+
+    segment.jobSlot = segment.currentSlot;
+    segment.jobChannels = activeChannels;
+    segment.jobState.store(pending, std::memory_order_release);
+    segment.currentSlot ^= 1;
+
+    // Без блокировки: пропущенное пробуждение покрывает таймаут потока и дедлайн
+    wakeUp.notify_one();
+}
+
+void NonUniformConvolver::waitForJob(TailSegment& segment) noexcept
+{
+    int expected = pending;
+
+    // Поток не успел взять задание - оно считается здесь: верный выход важнее ровной нагрузки
+    if (segment.jobState.compare_exchange_strong(expected, running, std::memory_order_acquire))
+    {
+        runJob(segment);
+        segment.jobState.store(idle, std::memory_order_release);
+        return;
+    }
+
+    // Задание уже считается: ожидание ограничено остатком одного задания -
+    // поток не прерывает его ради другого, а наивысший приоритет не дает
+    // обычным задачам системы вытеснить его на время ожидания
+    while (segment.jobState.load(std::memory_order_acquire) != idle)
+        std::this_thread::yield();
+}
+
+void NonUniformConvolver::runJob(TailSegment& segment) noexcept
+{
+    for (int channel = 0; channel < segment.jobChannels; ++channel)
+    {
+        segment.convolvers[static_cast<size_t>(channel)].process(
+            segment.block(segment.inputBlocks, channel, segment.jobSlot),
+            segment.block(segment.outputBlocks, channel, segment.jobSlot));
+    }
+}
+
+//==============================================================================
+void NonUniformConvolver::startWorker()
+{
+    // Наивысший приоритет: иначе дедлайн ждал бы поток, вытесненный
+    // обычными задачами системы (инверсия приоритетов)
+    worker.startThread(juce::Thread::Priority::highest);
+}
+
+void NonUniformConvolver::stopWorker()
+{
+    if (! worker.isThreadRunning())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(wakeLock);
+        worker.signalThreadShouldExit();
+    }
+
+    // Задание в полете дописывается: поток не прерывается посреди свертки
+    wakeUp.notify_one();
+    worker.stopThread(-1);
+}
+
+void NonUniformConvolver::workerLoop()
+{
+    while (! worker.threadShouldExit())
+    {
+        if (runNextJob())
+            continue;
+
+        std::unique_lock<std::mutex> lock(wakeLock);
+        wakeUp.wait_for(lock, std::chrono::milliseconds(10),
+                        [this] { return worker.threadShouldExit() || hasPendingJob(); });
+    }
+}
+
+bool NonUniformConvolver::runNextJob() noexcept
+{
+    // Сегменты упорядочены по размеру части: у меньших ближе дедлайн
+    for (auto& segment : tailSegments)
+    {
+        int expected = pending;
+
+        if (segment->jobState.compare_exchange_strong(expected, running, std::memory_order_acquire))
+        {
+            runJob(*segment);
+            segment->jobState.store(idle, std::memory_order_release);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool NonUniformConvolver::hasPendingJob() const noexcept
+{
+    for (const auto& segment : tailSegments)
+        if (segment->jobState.load(std::memory_order_relaxed) == pending)
+            return true;
+
+    return false;
+}
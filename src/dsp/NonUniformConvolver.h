@@ -0,0 +1,151 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "PartitionedConvolver.h"
+
+/**
+ * @brief Свертка без задержки с неравномерным разбиением (Gardner, 1995)
+ *
+ * Импульсная характеристика делится на сегменты с растущим размером части:
+ * - голова [0, headSize) - прямая форма (FIR) на аудио-потоке;
+ * - синхронный сегмент - PartitionedConvolver с частью headSize со
+ *   смещения headSize: его задержка в одну часть совпадает со смещением;
+ * - хвостовые сегменты - части в growthFactor раз больше предыдущих (до
+ *   maxPartitionSize), каждый начинается со смещения 2B от своей части B.
+ *
+ * Хвостовой сегмент считается рабочим потоком (juce::Thread с наивысшим
+ * приоритетом): блок входа, набранный к концу периода, нужен на выходе
+ * только через период, поэтому у задания есть целый период на расчет, а
+ * аудио-поток лишь копирует вход и выход (по два буфера на сегмент).
+ * Поток берет задания по возрастанию части - у меньших ближе дедлайн. На
+ * дедлайне аудио-поток синхронизируется с заданием; если поток его так и
+ * не взял, задание считается на месте - выход всегда верный, а нагрузка
+ * аудио-потока в обычном случае ровная: голова, один малый FFT-сегмент и
+ * копирование, без всплесков на границах больших частей.
+ *
+ * Суммарная задержка - ноль сэмплов.
+ *
+ * Сегменты строятся один раз на экземпляр и не перестраиваются, пока
+ * process() может их обходить: новая характеристика - новый экземпляр,
+ * который ConvolutionEngine передает аудио-потоку заменой набора. Рабочий
+ * поток останавливается только в деструкторе снятого экземпляра.
+ */
+class NonUniformConvolver
+{
+public:
+    //==============================================================================
+    static constexpr int maxChannels = 2;
+    static constexpr int headSize = 64;             // Прямая форма и часть синхронного сегмента
+    static constexpr int growthFactor = 4;
+    static constexpr int maxPartitionSize = 16384;
+
+    //==============================================================================
+    NonUniformConvolver();
+    ~NonUniformConvolver();
+
+    //==============================================================================
+    // Подготовка и загрузка - один раз, вне аудио-потока и до первого
+    // process(); рабочий поток запускается загрузкой
+    void prepare(int numChannels, double sampleRate);
+    void loadImpulseResponse(const float* const* channels, int numSamples);
+    void reset();
+    bool isReady() const { return isPrepared; }
+
+    int getNumTailSegments() const { return static_cast<int>(tailSegments.size()); }
+
+    //==============================================================================
+    // Блок любого размера, выход без задержки. numChannels - не больше
+    // подготовленных; inputs и outputs могут совпадать.
+    void process(const float* const* inputs, float* const* outputs,
+                 int numChannels, int numSamples) noexcept;
+
+private:
+    //==============================================================================
+    enum JobState
+    {
+        idle,
+        pending,
+        running
+    };
+
+    struct TailSegment
+    {
+        int offset = 0;
+        int partitionSize = 0;
+        std::array<PartitionedConvolver, maxChannels> convolvers;
+
+        // Двойные буферы [channel][slot][partitionSize]: аудио-поток заполняет
+        // слот currentSlot, задание читает и пишет другой
+        std::vector<float> inputBlocks;
+        std::vector<float> outputBlocks;
+        int currentSlot = 0;
+
+        // Задание: заполняется аудио-потоком до публикации через jobState
+        int jobSlot = 0;
+        int jobChannels = 0;
+        std::atomic<int> jobState { idle };
+
+        float* block(std::vector<float>& blocks, int channel, int slot) noexcept
+        {
+            return blocks.data() + static_cast<size_t>(channel * 2 + slot) * static_cast<size_t>(partitionSize);
+        }
+    };
+
+    //==============================================================================
+    // Состояние
+    double sampleRate = 44100.0;
+    int numChannels = maxChannels;
+    bool isPrepared = false;
+    std::uint32_t samplesProcessed = 0;     // По модулю 2^32 - кратно любой части
+
+    // Голова: обращенные коэффициенты (выровнены для SimdOps::load) и
+    // история [headSize - 1 прошлых | блок]
+    alignas(64) std::array<std::array<float, headSize>, maxChannels> headTaps {};
+    std::array<std::vector<float>, maxChannels> headHistory;
+
+    // Синхронный сегмент: FIFO на одну часть, как в ConvolutionEngine
+    std::array<PartitionedConvolver, maxChannels> syncConvolvers;
+    std::array<std::vector<float>, maxChannels> syncFifo;
+
+    // Хвост по возрастанию части
+    std::vector<std::unique_ptr<TailSegment>> tailSegments;
+
+    // Рабочий поток
+    class Worker : public juce::Thread
+    {
+    public:
+        explicit Worker(NonUniformConvolver& owner)
+            : juce::Thread("Spreadra convolution tail"), owner(owner) {}
+
+        void run() override { owner.workerLoop(); }
+
+    private:
+        NonUniformConvolver& owner;
+    };
+
+    Worker worker { *this };
+    std::mutex wakeLock;
+    std::condition_variable wakeUp;
+
+    //==============================================================================
+    void processHead(int channel, const float* input, float* output, int numSamples) noexcept;
+    void finishTailBlock(TailSegment& segment, int activeChannels) noexcept;
+    void waitForJob(TailSegment& segment) noexcept;
+    static void runJob(TailSegment& segment) noexcept;
+
+    void startWorker();
+    void stopWorker();
+    void workerLoop();
+    bool runNextJob() noexcept;
+    bool hasPendingJob() const noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(NonUniformConvolver)
+};
@@ -0,0 +1,169 @@
+#include "PartitionedConvolver.h"
+#include "SimdOps.h"
+#include <algorithm>
+
+//==============================================================================
+void PartitionedConvolver::prepare(int partitionSize, double sampleRate)
+{
+    jassert(juce::isPowerOfTwo(partitionSize));
+
+    // Повторный prepare() с тем же размером ничего не перестраивает
+    if (isPrepared && partitionSize == this->partitionSize)
+        return;
+
+    this->partitionSize = partitionSize;
+    numBins = partitionSize + 1;
+
+    // Длина строки кратна 64 байтам: при выровненном начале AlignedBuffer
+    // выровнена каждая строка re и im
+    stride = AlignedBuffer::roundUpToAlignment(static_cast<size_t>(numBins));
+
+    fft.prepare(2 * partitionSize, sampleRate);
+
+    inputWindow = FFTEngine::allocateRealBuffer(2 * partitionSize);
+    outputWindow = FFTEngine::allocateRealBuffer(2 * partitionSize);
+    spectrum = FFTEngine::allocateSpectrumBuffer(numBins);
+    accumulator.allocate(2 * stride);
+
+    isPrepared = true;
+
+    // Части прежней характеристики рассчитаны на старый размер
+    loadImpulseResponse(nullptr, 0);
+}
+
+void PartitionedConvolver::loadImpulseResponse(const float* impulse, int numSamples)
+{
+    jassert(isPrepared);
+
+    numPartitions = (juce::jmax(0, numSamples) + partitionSize - 1) / partitionSize;
+
+    const int numSlots = juce::jmax(1, numPartitions);
+    filterSpectra.allocate(static_cast<size_t>(numSlots) * 2 * stride);
+    delayLine.allocate(static_cast<size_t>(numSlots) * 2 * stride);
+
+    // Часть дополняется нулями до 2B; нормировка обратного FFT - сразу в спектр
+    const float scale = 1.0f / static_cast<float>(2 * partitionSize);
+    float* window = inputWindow.get();
+
+    for (int partition = 0; partition < numPartitions; ++partition)
+    {
+        const int start = partition * partitionSize;
+        const int count = juce::jmin(partitionSize, numSamples - start);
+
+        std::fill(window, window + 2 * partitionSize, 0.0f);
+
+        for (int i = 0; i < count; ++i)
+            window[i] = impulse[start + i] * scale;
+
+        fft.forwardTransform(window, spectrum.get());
+        splitSpectrum(slotData(filterSpectra, partition));
+    }
+
+    reset();
+}
+
+void PartitionedConvolver::reset()
+{
+    if (! isPrepared)
+        return;
+
+    // FDL не очищается: слоты до filledSlots не читаются
+    std::fill(inputWindow.get(), inputWindow.get() + 2 * partitionSize, 0.0f);
+    newestSlot = 0;
+    filledSlots = 0;
+}
+
+//==============================================================================
+void PartitionedConvolver::process(const float* input, float* output) noexcept
+{
+    const int size = partitionSize;
+    float* window = inputWindow.get();
+
+    // Окно сдвигается на блок: [предыдущий | текущий]
+    std::copy(window + size, window + 2 * size, window);
+    std::copy(input, input + size, window + size);
+
+    if (numPartitions == 0)
+    {
+        std::fill(output, output + size, 0.0f);
+        return;
+    }
+
+    // Спектр входа - в самый новый слот FDL (кольцо идет назад)
+    newestSlot = (newestSlot == 0 ? numPartitions : newestSlot) - 1;
+    filledSlots = juce::jmin(filledSlots + 1, numPartitions);
+
+    fft.forwardTransform(window, spectrum.get());
+    splitSpectrum(slotData(delayLine, newestSlot));
+
+    // Y = сумма X[n - p] * H[p]: слот newestSlot + p (по модулю) хранит X[n - p]
+    std::fill(accumulator.get(), accumulator.get() + 2 * stride, 0.0f);
+
+    int slot = newestSlot;
+
+    for (int partition = 0; partition < filledSlots; ++partition)
+    {
+        multiplyAccumulate(slotData(delayLine, slot), slotData(filterSpectra, partition));
+
+        if (++slot == numPartitions)
+            slot = 0;
+    }
+
+    // Overlap-save: верная свертка - вторая половина обратного FFT
+    joinSpectrum(accumulator.get());
+    fft.inverseTransform(spectrum.get(), outputWindow.get());
+
+    std::copy(outputWindow.get() + size, outputWindow.get() + 2 * size, output);
+}
+
+//==============================================================================
+void PartitionedConvolver::splitSpectrum(float* destination) const noexcept
+{
+    float* re = destination;
+    float* im = destination + stride;
+    const std::complex<float>* bins = spectrum.get();
+
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        re[bin] = bins[bin].real();
+        im[bin] = bins[bin].imag();
+    }
+
+    // Хвост строки до stride - нули: векторный цикл идет по всей строке
+    std::fill(re + numBins, re + stride, 0.0f);
+    std::fill(im + numBins, im + stride, 0.0f);
+}
+
+void PartitionedConvolver::joinSpectrum(const float* source) noexcept
+{
+    const float* re = source;
+    const float* im = source + stride;
+    std::complex<float>* bins = spectrum.get();
+
+    for (int bin = 0; bin < numBins; ++bin)
+        bins[bin] = std::complex<float>(re[bin], im[bin]);
+}
+
+void PartitionedConvolver::multiplyAccumulate(const float* signal, const float* filter) noexcept
+{
+    using namespace SimdOps;
+
+    const float* signalRe = signal;
+    const float* signalIm = signal + stride;
+    const float* filterRe = filter;
+    const float* filterIm = filter + stride;
+    float* accRe = accumulator.get();
+    float* accIm = accumulator.get() + stride;
+
+    // (a + bi)(c + di) = (ac - bd) + (ad + bc)i по width бинов за раз
+    for (size_t bin = 0; bin < stride; bin += static_cast<size_t>(width))
+    {
+        const Vec a = load(signalRe + bin);
+        const Vec b = load(signalIm + bin);
+        const Vec c = load(filterRe + bin);
+        const Vec d = load(filterIm + bin);
+
+        store(accRe + bin, add(load(accRe + bin), sub(mul(a, c), mul(b, d))));
+        store(accIm + bin, add(load(accIm + bin), add(mul(a, d), mul(b, c))));
+    }
+}
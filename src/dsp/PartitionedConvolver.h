@@ -0,0 +1,82 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "AlignedBuffer.h"
+#include "FFTEngine.h"
+
+/**
+ * @brief Равномерно разбитая свертка overlap-save в частотной области (UPOLS)
+ *
+ * Импульсная характеристика режется на P частей по B сэмплов, спектр
+ * каждой части (FFT размера 2B) считается один раз при загрузке. На каждом
+ * блоке из B сэмплов считается одно FFT входа: его спектр попадает в
+ * частотную линию задержки (FDL) из P спектров, а выход - сумма
+ * произведений спектров FDL на спектры частей и одно обратное FFT.
+ * Стоимость блока - два FFT и P комплексных умножений-накоплений по
+ * B + 1 бинам, то есть линейна по длине характеристики и постоянна
+ * от блока к блоку.
+ *
+ * Спектры хранятся раздельно (re и im по stride float, строки выровнены
+ * по 64 байта), поэтому умножение-накопление идет выровненными векторами
+ * SimdOps по бинам.
+ * 1/2B обратного FFT внесено в спектры частей. reset() - O(1): слоты
+ * FDL после сброса не читаются, пока не будут перезаписаны.
+ */
+class PartitionedConvolver
+{
+public:
+    //==============================================================================
+    PartitionedConvolver() = default;
+    ~PartitionedConvolver() = default;
+
+    //==============================================================================
+    // Подготовка (вне аудио-потока): partitionSize - степень двойки
+    void prepare(int partitionSize, double sampleRate);
+    void loadImpulseResponse(const float* impulse, int numSamples);
+    void reset();
+
+    bool isReady() const { return isPrepared; }
+    int getPartitionSize() const { return partitionSize; }
+    int getNumPartitions() const { return numPartitions; }
+
+    //==============================================================================
+    // Ровно partitionSize сэмплов: выход - свертка без задержки относительно
+    // входа этого же блока. input и output могут совпадать. Без аллокаций.
+    void process(const float* input, float* output) noexcept;
+
+private:
+    //==============================================================================
+    FFTEngine fft;
+
+    int partitionSize = 0;
+    int numBins = 0;                    // partitionSize + 1
+    size_t stride = 0;                  // numBins, округленное под SIMD
+    int numPartitions = 0;
+    bool isPrepared = false;
+
+    // Окно overlap-save: предыдущий и текущий блоки входа (2B) - буферы FFT
+    FFTEngine::RealBuffer inputWindow;
+    FFTEngine::RealBuffer outputWindow;
+    FFTEngine::SpectrumBuffer spectrum;
+
+    // Спектры частей и FDL: [partition][re | im][stride]. fftwf_malloc
+    // выравнивает только под SIMD самого FFTW - строки в AlignedBuffer
+    AlignedBuffer filterSpectra;
+    AlignedBuffer delayLine;
+    AlignedBuffer accumulator;          // re | im
+
+    int newestSlot = 0;                 // Слот FDL с последним спектром входа
+    int filledSlots = 0;                // Слоты, записанные после reset()
+
+    //==============================================================================
+    float* slotData(AlignedBuffer& buffer, int slot) noexcept
+    {
+        return buffer.get() + static_cast<size_t>(slot) * 2 * stride;
+    }
+
+    void splitSpectrum(float* destination) const noexcept;
+    void joinSpectrum(const float* source) noexcept;
+    void multiplyAccumulate(const float* signal, const float* filter) noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PartitionedConvolver)
+};
@@ -15,66 +15,125 @@ ReverbAlgorithm::~ReverbAlgorithm()
 }
 
 //==============================================================================
-void ReverbAlgorithm::prepare(double sampleRate, int blockSize)
+void ReverbAlgorithm::prepare(double sampleRate, int maxHostBlockSize)
 {
+    // Блок хоста режется на микро-блоки (MicroBlock::forEach), поэтому
+    // компоненты и арена готовятся под один микро-блок независимо от хоста.
+    // Размер блока хоста нужен только свертке - под него выбирается часть
     this->sampleRate = sampleRate;
-    this->blockSize = blockSize;
+    this->blockSize = MicroBlock::size;
+    this->maxHostBlockSize = maxHostBlockSize;
     
-    // Подготовка DSP компонентов
+    // Подготовка DSP компонентов: каждый сравнивает частоту и размеры с
+    // текущими и переиспользует память, при той же частоте - и состояние
     reverbEngine.prepare(sampleRate, blockSize);
+    
+    // FDN и свертка готовятся только если выбраны - иначе при первом переключении
+    fdnEngine.setOrder(params.fdnOrder);
+    fdnEngine.setMatrixType(params.fdnMatrix);
+    prepareEngine(params.engineType);
+    
     filterBank.prepare(sampleRate, blockSize);
     
-    // Инициализация временных буферов
-    tempBuffer1.resize(blockSize);
-    tempBuffer2.resize(blockSize);
-    tempBuffer3.resize(blockSize);
-    tempBufferL.resize(blockSize);
-    tempBufferR.resize(blockSize);
+    // Инициализация арены временных буферов
+    scratch.prepare(numScratchBuffers, blockSize);
+    
+    // Линии задержки dry не зависят от частоты: выделяются один раз
+    if (!isPrepared)
+    {
+        dryDelayMemory.beginLayout();
+        for (auto& line : dryDelay)
+            line.setMaximumDelay(ConvolutionEngine::maxLatencySamples, dryDelayMemory);
+        dryDelayMemory.commit(false);
+    }
     
     // Обновление параметров DSP
     updateDSPParameters();
     
     isPrepared = true;
+    
+    // Аудио-поток остановлен: движок, набор свертки и задержка dry принимаются
+    // сразу, чтобы процессор сообщил хосту задержку уже из prepareToPlay()
+    releaseRetiredResources();
+    applyPendingChanges();
 }
 
 void ReverbAlgorithm::reset()
 {
     reverbEngine.reset();
+    if (fdnEngine.isReady())
+        fdnEngine.reset();
+    if (convolutionEngine.isReady())
+        convolutionEngine.reset();
     filterBank.reset();
+    scratch.reset();
     
-    // Очистка буферов
-    std::fill(tempBuffer1.begin(), tempBuffer1.end(), 0.0f);
-    std::fill(tempBuffer2.begin(), tempBuffer2.end(), 0.0f);
-    std::fill(tempBuffer3.begin(), tempBuffer3.end(), 0.0f);
-    std::fill(tempBufferL.begin(), tempBufferL.end(), 0.0f);
-    std::fill(tempBufferR.begin(), tempBufferR.end(), 0.0f);
+    for (auto& line : dryDelay)
+        line.clear();
 }
 
 //==============================================================================
 void ReverbAlgorithm::process(const float* input, float* output, int numSamples)
 {
-    if (!isPrepared || numSamples > blockSize)
+    if (!isPrepared)
         return;
     
-    // УПРОЩЕНО: всегда используем стерео обработку (дублируем моно на оба канала)
-    processStereoInternal(input, input, output, tempBuffer1.data(), numSamples);
+    applyPendingChanges();
     
-    // Берем только левый канал как результат моно
-    // (правый канал в tempBuffer1 игнорируется)
+    MicroBlock::forEach(numSamples, [&] (int offset, int count)
+    {
+        processMonoMicroBlock(input + offset, output + offset, count);
+    });
 }
 
 void ReverbAlgorithm::processStereo(const float* inputL, const float* inputR, 
                                     float* outputL, float* outputR, int numSamples)
 {
-    if (!isPrepared || numSamples > blockSize)
+    if (!isPrepared)
         return;
     
-    // Копирование входных сигналов
-    std::copy(inputL, inputL + numSamples, tempBufferL.data());
-    std::copy(inputR, inputR + numSamples, tempBufferR.data());
+    applyPendingChanges();
+    
+    // Dual mono (один буфер на оба канала) сохраняется в каждом микро-блоке
+    MicroBlock::forEach(numSamples, [&] (int offset, int count)
+    {
+        processStereoMicroBlock(inputL + offset, inputR + offset,
+                                outputL + offset, outputR + offset, count);
+    });
+}
+
+void ReverbAlgorithm::processMonoMicroBlock(const float* input, float* output, int numSamples)
+{
+    ScratchArena::ScopedFrame frame(scratch);
+    float* inputCopy = scratch.allocate(numSamples);
+    
+    // Копирование входа (хост может передать один буфер для входа и выхода)
+    std::copy(input, input + numSamples, inputCopy);
+    
+    processMonoInternal(inputCopy, output, numSamples);
+}
+
+void ReverbAlgorithm::processStereoMicroBlock(const float* inputL, const float* inputR,
+                                              float* outputL, float* outputR, int numSamples)
+{
+    ScratchArena::ScopedFrame frame(scratch);
+    float* inputCopyL = scratch.allocate(numSamples);
+    
+    // Копирование входных сигналов (хост может передать один буфер для входа и выхода)
+    std::copy(inputL, inputL + numSamples, inputCopyL);
+    
+    // Dual mono (один буфер на оба канала) - одна копия, движок пропустит даунмикс
+    const float* channelR = inputCopyL;
+    
+    if (inputR != inputL)
+    {
+        float* inputCopyR = scratch.allocate(numSamples);
+        std::copy(inputR, inputR + numSamples, inputCopyR);
+        channelR = inputCopyR;
+    }
     
     // Обработка через DSP chain
-    processStereoInternal(tempBufferL.data(), tempBufferR.data(), 
+    processStereoInternal(inputCopyL, channelR, 
                          outputL, outputR, numSamples);
 }
 
@@ -82,22 +141,80 @@ void ReverbAlgorithm::processStereo(const float* inputL, const float* inputR,
 void ReverbAlgorithm::setParameters(const Parameters& newParams)
 {
     params = newParams;
+    params.dryWet = MathUtils::clamp(params.dryWet, 0.0f, 100.0f);
+    params.stereoWidth = MathUtils::clamp(params.stereoWidth, 0.0f, 200.0f);
+    dryWetMix.store(params.dryWet, std::memory_order_relaxed);
+    stereoWidthMix.store(params.stereoWidth, std::memory_order_relaxed);
+    
+    if (isPrepared)
+        prepareEngine(params.engineType);
+    
     updateDSPParameters();
+    requestedEngine.store(params.engineType, std::memory_order_release);
 }
 
 
 
 void ReverbAlgorithm::setDryWet(float dryWetPercent)
 {
-    params.dryWet = MathUtils::clamp(dryWetPercent, 0.0f, 100.0f);
+    // Только атомарная запись: допускается и с аудио-потока
+    dryWetMix.store(MathUtils::clamp(dryWetPercent, 0.0f, 100.0f), std::memory_order_relaxed);
 }
 
 void ReverbAlgorithm::setStereoWidth(float stereoWidthPercent)
 {
+    // Сеть Schroeder получает ширину снимком (публикует только этот поток),
+    // FDN и M/S читают атомарное значение на аудио-потоке
     params.stereoWidth = MathUtils::clamp(stereoWidthPercent, 0.0f, 200.0f);
+    stereoWidthMix.store(params.stereoWidth, std::memory_order_relaxed);
     reverbEngine.setStereoWidth(params.stereoWidth);
 }
 
+void ReverbAlgorithm::setEngineType(EngineType newEngineType)
+{
+    // Линии FDN и части свертки выделяются при первом выборе движка - до
+    // публикации: аудио-поток переключится на уже готовый движок
+    if (isPrepared)
+    {
+        prepareEngine(newEngineType);
+        updateDSPParameters();
+    }
+    
+    params.engineType = newEngineType;
+    requestedEngine.store(newEngineType, std::memory_order_release);
+}
+
+void ReverbAlgorithm::setFDNOrder(int newOrder)
+{
+    params.fdnOrder = newOrder;
+    fdnEngine.setOrder(newOrder);
+}
+
+void ReverbAlgorithm::setFDNMatrixType(FDNEngine::MatrixType newMatrix)
+{
+    params.fdnMatrix = newMatrix;
+    fdnEngine.setMatrixType(newMatrix);
+}
+
+void ReverbAlgorithm::setImpulseResponse(const float* const* channels, int numChannels,
+                                         int numSamples, double irSampleRate)
+{
+    // Характеристика хранится и до prepare() - части строятся при подготовке свертки
+    convolutionEngine.loadImpulseResponse(channels, numChannels, numSamples, irSampleRate);
+}
+
+void ReverbAlgorithm::setConvolutionPartitioning(ConvolutionEngine::Partitioning newPartitioning)
+{
+    // Новый набор свертки и задержку dry аудио-поток примет на границе блока
+    params.convolutionPartitioning = newPartitioning;
+    convolutionEngine.setPartitioning(newPartitioning);
+}
+
+void ReverbAlgorithm::releaseRetiredResources()
+{
+    convolutionEngine.releaseRetiredSets();
+}
+
 //==============================================================================
 float ReverbAlgorithm::getCpuUsage() const
 {
@@ -110,12 +227,28 @@ float ReverbAlgorithm::getCpuUsage() const
 
 float ReverbAlgorithm::getLatency() const
 {
+    // Свертка задерживает wet на одну часть (FIFO) или не задерживает вовсе
+    if (activeEngine.load(std::memory_order_relaxed) == EngineType::Convolution && convolutionEngine.isReady())
+        return static_cast<float>(getLatencySamples() * 1000.0 / sampleRate);
+    
     // Расчет общей задержки
     float reverbLatency = 10.0f; // Минимальная задержка реверберации
     
     return reverbLatency;
 }
 
+int ReverbAlgorithm::getLatencySamples() const
+{
+    // Задержка, которую аудио-поток уже применил (к dry - тоже)
+    return latencySamples.load(std::memory_order_acquire);
+}
+
+bool ReverbAlgorithm::isReverbSleeping() const
+{
+    // Сон поддерживает только сеть Schroeder
+    return activeEngine.load(std::memory_order_relaxed) == EngineType::Schroeder && reverbEngine.isSleeping();
+}
+
 void ReverbAlgorithm::getSpectrum(float* spectrum, int numBins)
 {
     // Заполнение спектра нулями (заглушка)
@@ -130,43 +263,170 @@ void ReverbAlgorithm::updateDSPParameters()
     
     // Обновление параметров spreadra engine
     reverbEngine.setStereoWidth(params.stereoWidth);
+    
+    // FDN: порядок сеть примет в начале следующего блока, память не трогается.
+    // Ширину FDN применяет аудио-поток (applyPendingChanges)
+    fdnEngine.setOrder(params.fdnOrder);
+    fdnEngine.setMatrixType(params.fdnMatrix);
+}
+
+void ReverbAlgorithm::applyPendingChanges() noexcept
+{
+    // Аудио-поток, начало блока: все, что выставили сеттеры, вступает в силу здесь.
+    // Движок опубликован уже подготовленным (release в сеттере)
+    const EngineType engine = requestedEngine.load(std::memory_order_acquire);
+    activeEngine.store(engine, std::memory_order_relaxed);
+    
+    // Ширина FDN - только пока FDN выбран: невыбранный FDN может готовиться
+    // сеттером движка на другом потоке
+    const float width = stereoWidthMix.load(std::memory_order_relaxed);
+    
+    if (engine == EngineType::FDN && width != fdnStereoWidth && fdnEngine.isReady())
+    {
+        fdnStereoWidth = width;
+        fdnEngine.setStereoWidth(width);
+    }
+    
+    convolutionEngine.applyPendingSet();
+    
+    // Алгоритмические движки без упреждения: сдвиг вносит только равномерная свертка.
+    // Линии рассчитаны на максимум задержки движка: урезанная задержка
+    // молча развела бы dry и wet
+    const int newDelay = engine == EngineType::Convolution && convolutionEngine.isReady()
+        ? convolutionEngine.getLatencySamples()
+        : 0;
+    jassert(newDelay <= dryDelay[0].getMaximumDelay());
+    
+    if (newDelay != dryDelaySamples)
+    {
+        // Линии очищаются: старая история задержана на другое число сэмплов
+        for (auto& line : dryDelay)
+            line.clear();
+        
+        dryDelaySamples = newDelay;
+        
+        // Хост узнает задержку только теперь, когда dry и wet уже сдвинуты
+        latencySamples.store(newDelay, std::memory_order_release);
+    }
+}
+
+void ReverbAlgorithm::prepareEngine(EngineType engineType)
+{
+    // FDN, подготовленный на другой частоте, пересчитывает длины и затухание
+    // (память линий при той же частоте и порядке переиспользуется)
+    if (engineType == EngineType::FDN
+        && (!fdnEngine.isReady() || fdnEngine.getSampleRate() != sampleRate))
+        fdnEngine.prepare(sampleRate, blockSize);
+    
+    // Свертка готовится и при каждом prepare(): блок хоста задает размер части,
+    // при тех же частоте и размере она сохраняет состояние
+    if (engineType == EngineType::Convolution)
+    {
+        convolutionEngine.setPartitioning(params.convolutionPartitioning);
+        convolutionEngine.prepare(sampleRate, maxHostBlockSize);
+    }
+}
+
+const float* ReverbAlgorithm::delayDry(int channel, const float* input, float* destination, int numSamples) noexcept
+{
+    if (dryDelaySamples == 0)
+        return input;
+    
+    auto& line = dryDelay[static_cast<size_t>(channel)];
+    
+    // Чтение до записи: read(d) - сэмпл, записанный d сэмплов назад
+    for (int i = 0; i < numSamples; ++i)
+    {
+        destination[i] = line.read(dryDelaySamples);
+        line.push(input[i]);
+    }
+    
+    return destination;
 }
 
 //==============================================================================
 
+void ReverbAlgorithm::processMonoInternal(const float* input, float* output, int numSamples)
+{
+    ScratchArena::ScopedFrame frame(scratch);
+    
+    // Dry выровнен с wet движка (задержка свертки) и при dry/wet = 0%
+    const float* dry = delayDry(0, input, scratch.allocate(numSamples), numSamples);
+    const float dryWet = dryWetMix.load(std::memory_order_relaxed);
+    
+    if (dryWet <= 0.0f)
+    {
+        std::copy(dry, dry + numSamples, output);
+        return;
+    }
+    
+    float* wet = scratch.allocate(numSamples);
+    
+    // Моно движок Schroeder считает один канал сети
+    const EngineType engine = activeEngine.load(std::memory_order_relaxed);
+    
+    if (engine == EngineType::FDN && fdnEngine.isReady())
+        fdnEngine.process(input, wet, numSamples);
+    else if (engine == EngineType::Convolution && convolutionEngine.isReady())
+        convolutionEngine.process(input, wet, numSamples);
+    else
+        reverbEngine.process(input, wet, numSamples);
+    
+    // Простой микс dry/wet (стерео ширина для моно не применяется)
+    float dryMixGain = (100.0f - dryWet) / 100.0f;
+    float wetMixGain = dryWet / 100.0f;
+    
+    for (int i = 0; i < numSamples; ++i)
+        output[i] = dryMixGain * dry[i] + wetMixGain * wet[i];
+}
+
 void ReverbAlgorithm::processStereoInternal(const float* inputL, const float* inputR, 
                                             float* outputL, float* outputR, int numSamples)
 {
+    ScratchArena::ScopedFrame frame(scratch);
+    
+    // Dry выровнен с wet движка (задержка свертки)
+    const float* dryL = delayDry(0, inputL, scratch.allocate(numSamples), numSamples);
+    const float* dryR = delayDry(1, inputR, scratch.allocate(numSamples), numSamples);
+    const float dryWet = dryWetMix.load(std::memory_order_relaxed);
+    
     // Если dry/wet = 0%, только dry сигнал (оптимизация)
-    if (params.dryWet <= 0.0f)
+    if (dryWet <= 0.0f)
     {
-        std::copy(inputL, inputL + numSamples, outputL);
-        std::copy(inputR, inputR + numSamples, outputR);
+        std::copy(dryL, dryL + numSamples, outputL);
+        std::copy(dryR, dryR + numSamples, outputR);
         return;
     }
     
-    // Обрабатываем wet сигнал через SpreadraEngine
-    std::copy(inputL, inputL + numSamples, tempBufferL.data());
-    std::copy(inputR, inputR + numSamples, tempBufferR.data());
-    reverbEngine.processStereo(tempBufferL.data(), tempBufferR.data(), 
-                              tempBuffer1.data(), tempBuffer2.data(), numSamples);
+    float* wetL = scratch.allocate(numSamples);
+    float* wetR = scratch.allocate(numSamples);
+    
+    // Обрабатываем wet сигнал через выбранный движок
+    const EngineType engine = activeEngine.load(std::memory_order_relaxed);
+    
+    if (engine == EngineType::FDN && fdnEngine.isReady())
+        fdnEngine.processStereo(inputL, inputR, wetL, wetR, numSamples);
+    else if (engine == EngineType::Convolution && convolutionEngine.isReady())
+        convolutionEngine.processStereo(inputL, inputR, wetL, wetR, numSamples);
+    else
+        reverbEngine.processStereo(inputL, inputR, wetL, wetR, numSamples);
     
     // Простой микс dry/wet
-    float dryMixGain = (100.0f - params.dryWet) / 100.0f;
-    float wetMixGain = params.dryWet / 100.0f;
+    float dryMixGain = (100.0f - dryWet) / 100.0f;
+    float wetMixGain = dryWet / 100.0f;
     
     for (int i = 0; i < numSamples; ++i)
     {
-        float drySignalL = inputL[i];
-        float drySignalR = inputR[i];
-        float wetSignalL = tempBuffer1[i];
-        float wetSignalR = tempBuffer2[i];
+        float drySignalL = dryL[i];
+        float drySignalR = dryR[i];
+        float wetSignalL = wetL[i];
+        float wetSignalR = wetR[i];
         outputL[i] = dryMixGain * drySignalL + wetMixGain * wetSignalL;
         outputR[i] = dryMixGain * drySignalR + wetMixGain * wetSignalR;
     }
     
     // Mid-Side преобразование для управления стерео шириной
-    float widthFactor = params.stereoWidth / 100.0f; // 0.0 - 2.0
+    float widthFactor = stereoWidthMix.load(std::memory_order_relaxed) / 100.0f; // 0.0 - 2.0
     
     for (int i = 0; i < numSamples; ++i)
     {
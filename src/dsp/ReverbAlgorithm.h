@@ -2,7 +2,14 @@
 
 #include <juce_audio_processors/juce_audio_processors.h>
 #include "ReverbEngine.h"
+#include "FDNEngine.h"
+#include "ConvolutionEngine.h"
 #include "FilterBank.h"
+#include "ScratchArena.h"
+#include "MicroBlock.h"
+#include "DelayLine.h"
+#include "DelayLineArena.h"
+#include <atomic>
 
 /**
  * @brief Основной DSP алгоритм для реверберации
@@ -11,7 +18,16 @@
  * Input → Reverb → Output
  * 
  * Алгоритм основан на работе Schroeder (1961) и современных
- * методах цифровой обработки сигналов.
+ * методах цифровой обработки сигналов. Вместо сети Schroeder можно
+ * выбрать FDN (FDNEngine) - плотнее хвост, стоимость задается порядком -
+ * или свертку с импульсной характеристикой (ConvolutionEngine).
+ *
+ * Блок хоста любого размера режется на микро-блоки MicroBlock::size -
+ * вся цепочка и ее временные буферы работают в пределах L1.
+ *
+ * Если движок задерживает wet (равномерная свертка), dry задерживается на
+ * те же getLatencySamples(): после компенсации хостом dry совпадает с
+ * остальными дорожками, а хвост - с dry.
  */
 class ReverbAlgorithm
 {
@@ -21,16 +37,28 @@ public:
     ~ReverbAlgorithm();
 
     //==============================================================================
-    // Основная обработка аудио
+    // Основная обработка аудио. process() - моно путь; processStereo() с одним
+    // и тем же буфером на inputL и inputR обрабатывается как dual mono.
+    // numSamples не ограничен размером блока из prepare()
     void process(const float* input, float* output, int numSamples);
     void processStereo(const float* inputL, const float* inputR, 
                       float* outputL, float* outputR, int numSamples);
 
     //==============================================================================
-    // Подготовка к воспроизведению
-    void prepare(double sampleRate, int blockSize);
+    // Подготовка к воспроизведению: компоненты готовятся под микро-блок,
+    // максимальный блок хоста задает только размер части свертки
+    void prepare(double sampleRate, int maxHostBlockSize);
     void reset();
 
+    //==============================================================================
+    // Тип движка реверберации
+    enum class EngineType
+    {
+        Schroeder,      // ReverbEngine: comb + all-pass
+        FDN,            // FDNEngine: feedback delay network
+        Convolution     // ConvolutionEngine: импульсная характеристика
+    };
+
     //==============================================================================
     // Параметры алгоритма
     struct Parameters
@@ -38,6 +66,12 @@ public:
         // Spreadra parameters
         float stereoWidth = 100.0f;    // %, 0-150
         float dryWet = 50.0f;          // %, 0-100
+
+        // Выбор движка
+        EngineType engineType = EngineType::Schroeder;
+        int fdnOrder = 16;             // 8, 16 или 32
+        FDNEngine::MatrixType fdnMatrix = FDNEngine::MatrixType::Hadamard;
+        ConvolutionEngine::Partitioning convolutionPartitioning = ConvolutionEngine::Partitioning::Uniform;
     };
 
     void setParameters(const Parameters& newParams);
@@ -45,46 +79,83 @@ public:
 
     //==============================================================================
     // Индивидуальные параметры
-    void setDryWet(float dryWetPercent);
-    void setStereoWidth(float stereoWidthPercent);
+    void setDryWet(float dryWetPercent);            // Атомарно, допускается с аудио-потока
+    void setStereoWidth(float stereoWidthPercent);  // Публикует снимок - не с аудио-потока
+    void setEngineType(EngineType newEngineType);   // Может выделять память - не с аудио-потока;
+                                                    // движок переключается аудио-потоком на границе блока
+    void setFDNOrder(int newOrder);                 // Сеть переключается аудио-потоком на границе блока
+    void setFDNMatrixType(FDNEngine::MatrixType newMatrix);
+    void setImpulseResponse(const float* const* channels, int numChannels,  // Не с аудио-потока
+                            int numSamples, double irSampleRate);
+    void setConvolutionPartitioning(ConvolutionEngine::Partitioning newPartitioning);  // Не с аудио-потока
+
+    // Освобождение памяти, снятой аудио-потоком (периодически, вне аудио-потока)
+    void releaseRetiredResources();
 
     //==============================================================================
     // DSP компоненты
     ReverbEngine& getReverbEngine() { return reverbEngine; }
+    FDNEngine& getFDNEngine() { return fdnEngine; }
+    ConvolutionEngine& getConvolutionEngine() { return convolutionEngine; }
     FilterBank& getFilterBank() { return filterBank; }
 
     //==============================================================================
     // Метрики и диагностика
     float getCpuUsage() const;
     float getLatency() const;
+    int getLatencySamples() const;      // Задержка выхода для хоста - после переключения на аудио-потоке
+    bool isReverbSleeping() const;
     void getSpectrum(float* spectrum, int numBins);
 
 private:
     //==============================================================================
     // DSP компоненты
     ReverbEngine reverbEngine;
+    FDNEngine fdnEngine;
+    ConvolutionEngine convolutionEngine;
     FilterBank filterBank;
 
-    // Параметры
+    // Параметры (пишутся не с аудио-потока)
     Parameters params;
     
+    // То, что аудио-поток читает напрямую: микс и ширина M/S и FDN
+    std::atomic<float> dryWetMix { 50.0f };
+    std::atomic<float> stereoWidthMix { 100.0f };
+    float fdnStereoWidth = 100.0f;      // Примененная к FDN (аудио-поток)
+    
+    // Движок: сеттер публикует уже подготовленный, аудио-поток принимает
+    // его в начале блока. activeEngine пишет только аудио-поток
+    std::atomic<EngineType> requestedEngine { EngineType::Schroeder };
+    std::atomic<EngineType> activeEngine { EngineType::Schroeder };
+    
     // Состояние
     double sampleRate = 44100.0;
-    int blockSize = 512;
+    int blockSize = MicroBlock::size;   // Размер блока компонентов
+    int maxHostBlockSize = 512;         // Для размера части свертки
     bool isPrepared = false;
 
-    // Временные буферы
-    std::vector<float> tempBuffer1;
-    std::vector<float> tempBuffer2;
-    std::vector<float> tempBuffer3;
-    
-    // Стерео буферы
-    std::vector<float> tempBufferL;
-    std::vector<float> tempBufferR;
+    // Временные буферы на один микро-блок - выдаются из арены
+    static constexpr int numScratchBuffers = 6;
+    ScratchArena scratch;
+
+    // Задержка dry на задержку wet: память под максимальную задержку свертки.
+    // Меняет и очищает линии только аудио-поток; latencySamples - уже
+    // примененная задержка для хоста
+    DelayLineArena dryDelayMemory;
+    std::array<DelayLine, 2> dryDelay;
+    int dryDelaySamples = 0;
+    std::atomic<int> latencySamples { 0 };
 
     //==============================================================================
     // Внутренние методы
     void updateDSPParameters();
+    void applyPendingChanges() noexcept;
+    void prepareEngine(EngineType engineType);
+    const float* delayDry(int channel, const float* input, float* destination, int numSamples) noexcept;
+    void processMonoMicroBlock(const float* input, float* output, int numSamples);
+    void processStereoMicroBlock(const float* inputL, const float* inputR,
+                                 float* outputL, float* outputR, int numSamples);
+    void processMonoInternal(const float* input, float* output, int numSamples);
     void processStereoInternal(const float* inputL, const float* inputR, 
                               float* outputL, float* outputR, int numSamples);
 
@@ -1,5 +1,6 @@
 #include "ReverbEngine.h"
 #include "utils/MathUtils.h"
+#include "SimdOps.h"
 #include <algorithm>
 #include <iostream>
 
@@ -20,47 +21,109 @@ ReverbEngine::~ReverbEngine() = default;
 
 void ReverbEngine::prepare(double sampleRate, int blockSize)
 {
+    // Раскладка линий зависит только от sampleRate (память - под максимум
+    // комнаты и топологии), поэтому при той же частоте линии и состояние
+    // реверберации сохраняются. Блок длиннее, чем рассчитаны ранние отражения,
+    // обрабатывается частями - process() и так режет вход по blockSize
+    if (isPrepared && sampleRate == this->sampleRate)
+    {
+        this->blockSize = juce::jmin(blockSize, earlyReflections.getMaximumBlockSize());
+        scratch.prepare(numScratchBuffers, this->blockSize);
+        return;
+    }
+    
     this->sampleRate = sampleRate;
     this->blockSize = blockSize;
     
-    // Инициализация всех компонентов
+    // Инициализация всех компонентов: линии задержки резервируют участки
+    // в общей арене, память выделяется одним блоком после раскладки
+    delayMemory.beginLayout();
     initializeCombFilters();
     initializeAllPassFilters();
     initializeEarlyReflections();
+    initializePreDelay();
+    delayMemory.commit();
     
-    // Инициализация всех параметров
-    updateFilterParameters();
-    updatePreDelay();
-    updateEarlyReflections();
-    updateStereoMixing();
-    
-    // Подготовка временных буферов - стерео
-    tempBufferL.resize(blockSize, 0.0f);
-    tempBufferR.resize(blockSize, 0.0f);
-    combOutputL.resize(blockSize, 0.0f);
-    combOutputR.resize(blockSize, 0.0f);
-    allPassOutputL.resize(blockSize, 0.0f);
-    allPassOutputR.resize(blockSize, 0.0f);
-    earlyReflectionsBufferL.resize(blockSize, 0.0f);
-    earlyReflectionsBufferR.resize(blockSize, 0.0f);
+    // Инициализация всех параметров: снимок считается и сразу применяется
+    // (аудио-поток в prepare() остановлен)
+    useInitialDamping = true;
+    publishParameters();
+    pullParameters();
+    
+    // Подготовка арены временных буферов - после этого processStereo не выделяет память
+    scratch.prepare(numScratchBuffers, blockSize);
     
     isPrepared = true;
 }
 
 void ReverbEngine::process(const float* input, float* output, int numSamples)
 {
-    if (!isPrepared)
+    if (!isPrepared || combBank.isEmpty())
+    {
+        std::copy(input, input + numSamples, output);
         return;
-        
-    // ИСПРАВЛЕНО: Используем processStereo с дублированием входа для mono
-    processStereo(input, input, output, output, numSamples);
+    }
+    
+    // Последний снимок параметров применяется один раз в начале блока
+    pullParameters();
+    
+    // Настоящий моно путь: считается только левый канал сети
+    for (int offset = 0; offset < numSamples; offset += blockSize)
+    {
+        const int samplesThisTime = std::min(blockSize, numSamples - offset);
+        processMonoBlock(input + offset, output + offset, samplesThisTime);
+    }
+}
+
+void ReverbEngine::processMonoBlock(const float* input, float* output, int numSamples)
+{
+    const bool inputSilent = isBlockSilent(input, input, numSamples);
+    
+    if (sleeping && inputSilent)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            output[i] = input[i] * dry;
+        return;
+    }
+    
+    sleeping = false;
+    
+    ScratchArena::ScopedFrame frame(scratch);
+    
+    float* preDelayBuffer = scratch.allocate(numSamples);
+    float* combInput = scratch.allocate(numSamples);
+    float* reverb = scratch.allocate(numSamples);
+    
+    const float* reverbInput = processPreDelay(input, preDelayBuffer, numSamples);
+    
+    // Только отводы левого канала
+    float* const reflectionOutputs[] = { combInput };
+    earlyReflections.process(reverbInput, reflectionOutputs, numSamples, 1);
+    
+    for (int i = 0; i < numSamples; ++i)
+        combInput[i] += reverbInput[i];
+    
+    // Только comb и all-pass фильтры левого канала
+    const float* const combInputs[] = { combInput };
+    float* const combOutputs[] = { reverb };
+    combBank.process(combInputs, combOutputs, numSamples, 1);
+    
+    processAllPassChain(reverb, numSamples, allPassFiltersL);
+    
+    updateSleepState(inputSilent, reverb, reverb, numSamples);
+    
+    // Моно сумма стерео микса: оба wet коэффициента идут на единственный канал
+    const float wetMono = wet1 + wet2;
+    
+    for (int i = 0; i < numSamples; ++i)
+        output[i] = input[i] * dry + reverb[i] * wetMono;
 }
 
 void ReverbEngine::processStereo(const float* inputL, const float* inputR, 
                                  float* outputL, float* outputR, int numSamples)
 {
     // Stereo режим (оригинальный код)
-    if (!isPrepared || combFiltersL.empty() || combFiltersR.empty())
+    if (!isPrepared || combBank.isEmpty())
     {
         // Если не готов, просто копируем входы в выходы
         for (int i = 0; i < numSamples; ++i)
@@ -71,247 +134,434 @@ void ReverbEngine::processStereo(const float* inputL, const float* inputR,
         return;
     }
     
-    // Создаем моно-сигнал для подачи на реверб (как в Freeverb)
-    std::vector<float> monoInput(numSamples);
-    for (int i = 0; i < numSamples; ++i)
-    {
-        monoInput[i] = (inputL[i] + inputR[i]) * 0.5f;
-    }
-    
-    // Обрабатываем левый канал реверба
-    std::fill(tempBufferL.begin(), tempBufferL.end(), 0.0f);
-    std::fill(combOutputL.begin(), combOutputL.end(), 0.0f);
-    std::fill(allPassOutputL.begin(), allPassOutputL.end(), 0.0f);
+    // Последний снимок параметров применяется один раз в начале блока
+    pullParameters();
     
-    // Левый канал: Pre-delay
-    for (int i = 0; i < numSamples; ++i)
+    // Арена рассчитана на blockSize сэмплов - более длинный блок режем на части
+    for (int offset = 0; offset < numSamples; offset += blockSize)
     {
-        // ИСПРАВЛЕНО: Отключаем pre-delay для полного устранения delay эффекта
-        tempBufferL[i] = monoInput[i]; // Прямое подключение без задержки
+        const int samplesThisTime = std::min(blockSize, numSamples - offset);
+        processStereoBlock(inputL + offset, inputR + offset,
+                           outputL + offset, outputR + offset, samplesThisTime);
     }
+}
+
+void ReverbEngine::processStereoBlock(const float* inputL, const float* inputR,
+                                      float* outputL, float* outputR, int numSamples)
+{
+    // Спящая сеть: при тихом входе выдаем только dry, при звуке - просыпаемся сразу
+    const bool inputSilent = isBlockSilent(inputL, inputR, numSamples);
     
-    // ИСПРАВЛЕНО: Полностью отключаем early reflections для устранения delay эффекта
-    // Подаем сигнал напрямую в comb фильтры
-    std::vector<float> combInputL(numSamples);
-    for (int i = 0; i < numSamples; ++i)
+    if (sleeping && inputSilent)
     {
-        combInputL[i] = tempBufferL[i]; // Только pre-delay, без early reflections
+        for (int i = 0; i < numSamples; ++i)
+        {
+            outputL[i] = inputL[i] * dry;
+            outputR[i] = inputR[i] * dry;
+        }
+        return;
     }
     
-    // Левый канал: Parallel comb filters
-    for (size_t filterIndex = 0; filterIndex < combFiltersL.size(); ++filterIndex)
+    sleeping = false;
+    
+    ScratchArena::ScopedFrame frame(scratch);
+    
+    float* preDelayBuffer = scratch.allocate(numSamples);
+    float* combInputL = scratch.allocate(numSamples);
+    float* combInputR = scratch.allocate(numSamples);
+    float* reverbL = scratch.allocate(numSamples);
+    float* reverbR = scratch.allocate(numSamples);
+    
+    // Создаем моно-сигнал для подачи на реверб (как в Freeverb).
+    // Один и тот же буфер на L и R (dual mono) - это уже моно-сигнал
+    const float* monoInput = inputL;
+    
+    if (inputL != inputR)
     {
-        std::vector<float> filterOutput(numSamples);
-        processCombFilter(combInputL.data(), filterOutput.data(), numSamples, combFiltersL[filterIndex]);
+        float* downmix = scratch.allocate(numSamples);
         
         for (int i = 0; i < numSamples; ++i)
         {
-            combOutputL[i] += filterOutput[i];
+            downmix[i] = (inputL[i] + inputR[i]) * 0.5f;
         }
+        
+        monoInput = downmix;
     }
     
-    // ИСПРАВЛЕНО: Нормализация comb выхода для предотвращения перегруза
-    float combNormalizationFactor = 1.0f / static_cast<float>(combFiltersL.size());
+    // Pre-delay один на оба канала; при 0 ms - просто тот же указатель
+    const float* reverbInput = processPreDelay(monoInput, preDelayBuffer, numSamples);
+    
+    // Early reflections: одна линия на моно-вход, отводы L и R
+    float* const reflectionOutputs[] = { combInputL, combInputR };
+    earlyReflections.process(reverbInput, reflectionOutputs, numSamples);
+    
+    // Вход comb фильтров канала: сигнал + его ранние отражения
     for (int i = 0; i < numSamples; ++i)
     {
-        combOutputL[i] *= combNormalizationFactor;
+        combInputL[i] += reverbInput[i];
+        combInputR[i] += reverbInput[i];
     }
     
-    // Левый канал: Series all-pass filters
-    std::copy(combOutputL.begin(), combOutputL.end(), allPassOutputL.begin());
-    for (auto& filter : allPassFiltersL)
+    // Parallel comb filters обоих каналов
+    const float* const combInputs[] = { combInputL, combInputR };
+    float* const combOutputs[] = { reverbL, reverbR };
+    combBank.process(combInputs, combOutputs, numSamples);
+    
+    // Series all-pass filters
+    processAllPassChain(reverbL, numSamples, allPassFiltersL);
+    processAllPassChain(reverbR, numSamples, allPassFiltersR);
+    
+    updateSleepState(inputSilent, reverbL, reverbR, numSamples);
+    
+    // Финальное микширование стерео
+    for (int i = 0; i < numSamples; ++i)
     {
-        std::vector<float> filterOutput(numSamples);
-        processAllPassFilter(allPassOutputL.data(), filterOutput.data(), numSamples, filter);
-        std::copy(filterOutput.begin(), filterOutput.end(), allPassOutputL.begin());
+        // Используем стерео ширину для cross-mixing
+        float wetL = reverbL[i] * wet1 + reverbR[i] * wet2;
+        float wetR = reverbR[i] * wet1 + reverbL[i] * wet2;
+        
+        // Финальное микширование dry/wet
+        outputL[i] = inputL[i] * dry + wetL;
+        outputR[i] = inputR[i] * dry + wetR;
     }
+}
+
+bool ReverbEngine::isBlockSilent(const float* inputL, const float* inputR, int numSamples)
+{
+    float peak = 0.0f;
+    
+    for (int i = 0; i < numSamples; ++i)
+        peak = std::max(peak, std::max(std::abs(inputL[i]), std::abs(inputR[i])));
     
-    // Обрабатываем правый канал реверба
-    std::fill(tempBufferR.begin(), tempBufferR.end(), 0.0f);
-    std::fill(combOutputR.begin(), combOutputR.end(), 0.0f);
-    std::fill(allPassOutputR.begin(), allPassOutputR.end(), 0.0f);
+    return peak < silenceThreshold;
+}
+
+void ReverbEngine::updateSleepState(bool inputSilent, const float* reverbL, const float* reverbR, int numSamples)
+{
+    // Энергия хвоста - средний квадрат выхода сети за блок (громкий канал)
+    float energyL = 0.0f;
+    float energyR = 0.0f;
     
-    // Правый канал: Pre-delay
     for (int i = 0; i < numSamples; ++i)
     {
-        // ИСПРАВЛЕНО: Отключаем pre-delay для полного устранения delay эффекта
-        tempBufferR[i] = monoInput[i]; // Прямое подключение без задержки
+        energyL += reverbL[i] * reverbL[i];
+        energyR += reverbR[i] * reverbR[i];
     }
     
-    // ИСПРАВЛЕНО: Полностью отключаем early reflections для устранения delay эффекта
-    // Подаем сигнал напрямую в comb фильтры
-    std::vector<float> combInputR(numSamples);
-    for (int i = 0; i < numSamples; ++i)
+    tailEnergy = std::max(energyL, energyR) / static_cast<float>(juce::jmax(1, numSamples));
+    
+    if (!inputSilent || tailEnergy >= tailEnergyThreshold)
     {
-        combInputR[i] = tempBufferR[i]; // Только pre-delay, без early reflections
+        quietSamples = 0;
+        return;
     }
     
-    // Правый канал: Parallel comb filters
-    for (size_t filterIndex = 0; filterIndex < combFiltersR.size(); ++filterIndex)
+    // Засыпаем, только когда тишина длится дольше самого длинного пути через сеть:
+    // к этому моменту каждая линия задержки хотя бы раз выдала свое содержимое
+    quietSamples += numSamples;
+    
+    if (quietSamples >= getTailWindowSamples())
+        sleeping = true;
+}
+
+int ReverbEngine::getTailWindowSamples() const
+{
+    float longestComb = 0.0f;
+    
+    for (int channel = 0; channel < combBank.getNumChannels(); ++channel)
     {
-        std::vector<float> filterOutput(numSamples);
-        processCombFilter(combInputR.data(), filterOutput.data(), numSamples, combFiltersR[filterIndex]);
-        
-        for (int i = 0; i < numSamples; ++i)
+        for (int comb = 0; comb < combBank.getNumCombsPerChannel(); ++comb)
         {
-            combOutputR[i] += filterOutput[i];
+            longestComb = std::max(longestComb, combBank.getCurrentDelay(channel, comb));
+            longestComb = std::max(longestComb, combBank.getTargetDelay(channel, comb));
         }
     }
     
-    // ИСПРАВЛЕНО: Нормализация comb выхода для предотвращения перегруза  
-    for (int i = 0; i < numSamples; ++i)
+    // All-pass фильтры включены последовательно - их задержки складываются
+    int allPassChain = 0;
+    for (const auto* filters : { &allPassFiltersL, &allPassFiltersR })
     {
-        combOutputR[i] *= combNormalizationFactor;
+        int chain = 0;
+        for (int i = 0; i < numActiveAllPassFilters; ++i)
+        {
+            const auto& filter = (*filters)[static_cast<size_t>(i)];
+            chain += static_cast<int>(std::ceil(std::max(filter.currentDelayTime, filter.targetDelayTime)));
+        }
+        
+        allPassChain = std::max(allPassChain, chain);
     }
     
-    // Правый канал: Series all-pass filters
-    std::copy(combOutputR.begin(), combOutputR.end(), allPassOutputR.begin());
-    for (auto& filter : allPassFiltersR)
+    return preDelaySamples + earlyReflections.getMaximumDelay()
+         + static_cast<int>(std::ceil(longestComb)) + allPassChain;
+}
+
+const float* ReverbEngine::processPreDelay(const float* input, float* delayBuffer, int numSamples)
+{
+    const int delaySamples = preDelaySamples;
+    
+    if (delaySamples <= 0)
     {
-        std::vector<float> filterOutput(numSamples);
-        processAllPassFilter(allPassOutputR.data(), filterOutput.data(), numSamples, filter);
-        std::copy(filterOutput.begin(), filterOutput.end(), allPassOutputR.begin());
+        preDelayWasBypassed = true;
+        return input;
     }
     
-    // Финальное микширование стерео
-    for (int i = 0; i < numSamples; ++i)
+    // Пока стадия была выключена, линия не заполнялась - в ней старый сигнал
+    if (preDelayWasBypassed)
     {
-        // Используем стерео ширину для cross-mixing
-        float wetL = allPassOutputL[i] * wet1 + allPassOutputR[i] * wet2;
-        float wetR = allPassOutputR[i] * wet1 + allPassOutputL[i] * wet2;
-        
-        // Финальное микширование dry/wet
-        outputL[i] = inputL[i] * dry + wetL;
-        outputR[i] = inputR[i] * dry + wetR;
+        preDelayLine.clearLazily();
+        preDelayWasBypassed = false;
     }
+    
+    preDelayLine.prepareBlock(static_cast<float>(delaySamples), static_cast<float>(delaySamples), numSamples);
+    
+    // Участки не длиннее задержки: чтение и запись копируются целиком
+    preDelayLine.processInChunks(delaySamples, numSamples,
+        [&] (const float* delayedSamples, float* writeSamples, int offset, int count)
+        {
+            std::copy(delayedSamples, delayedSamples + count, delayBuffer + offset);
+            std::copy(input + offset, input + offset + count, writeSamples);
+        });
+    
+    return delayBuffer;
 }
 
-void ReverbEngine::reset()
+void ReverbEngine::processAllPassChain(float* buffer, int numSamples, AllPassChain& allPassFilters)
 {
-    // Левый канал
-    for (auto& filter : combFiltersL)
+    // Специализированные топологии - цепочка известной длины
+    switch (numActiveAllPassFilters)
     {
-        std::fill(filter.buffer.begin(), filter.buffer.end(), 0.0f);
-        filter.readIndex = 0;
-        filter.writeIndex = 0;
+        case ReverbTopologies::compact.numAllPasses: processAllPassChainKernel<ReverbTopologies::compact.numAllPasses>(buffer, numSamples, allPassFilters); break;
+        case ReverbTopologies::classic.numAllPasses: processAllPassChainKernel<ReverbTopologies::classic.numAllPasses>(buffer, numSamples, allPassFilters); break;
+        case ReverbTopologies::dense.numAllPasses:   processAllPassChainKernel<ReverbTopologies::dense.numAllPasses>(buffer, numSamples, allPassFilters); break;
+        default:                                     processAllPassChainKernel<0>(buffer, numSamples, allPassFilters); break;
     }
+}
+
+template <int FixedAllPasses>
+void ReverbEngine::processAllPassChainKernel(float* buffer, int numSamples, AllPassChain& allPassFilters)
+{
+    // FixedAllPasses == 0 - длина цепочки во время выполнения
+    const int numFilters = FixedAllPasses > 0 ? FixedAllPasses : numActiveAllPassFilters;
     
-    for (auto& filter : allPassFiltersL)
-    {
-        std::fill(filter.buffer.begin(), filter.buffer.end(), 0.0f);
-        filter.readIndex = 0;
-        filter.writeIndex = 0;
-    }
+    ScratchArena::ScopedFrame frame(scratch);
+    float* source = buffer;
+    float* destination = scratch.allocate(numSamples);
     
-    for (auto& reflection : earlyReflectionsL)
+    // Ступени пишут попеременно в два буфера, без копирования после каждой
+    for (int i = 0; i < numFilters; ++i)
     {
-        std::fill(reflection.buffer.begin(), reflection.buffer.end(), 0.0f);
-        reflection.readIndex = 0;
-        reflection.writeIndex = 0;
+        processAllPassFilter(source, destination, numSamples, allPassFilters[static_cast<size_t>(i)]);
+        std::swap(source, destination);
     }
     
-    // Правый канал
-    for (auto& filter : combFiltersR)
+    if (source != buffer)
+        std::copy(source, source + numSamples, buffer);
+}
+
+void ReverbEngine::reset()
+{
+    // Сброс за O(1): линии только запоминают позицию записи, старые отсчеты
+    // обнуляются перед блоками, которые до них дотягиваются (LazyClear)
+    
+    // Comb фильтры обоих каналов
+    combBank.reset();
+    
+    // Левый канал
+    for (auto& filter : allPassFiltersL)
     {
-        std::fill(filter.buffer.begin(), filter.buffer.end(), 0.0f);
-        filter.readIndex = 0;
-        filter.writeIndex = 0;
+        filter.line.clearLazily();
+        filter.interpolatorState = 0.0f;
     }
     
+    // Правый канал
     for (auto& filter : allPassFiltersR)
     {
-        std::fill(filter.buffer.begin(), filter.buffer.end(), 0.0f);
-        filter.readIndex = 0;
-        filter.writeIndex = 0;
+        filter.line.clearLazily();
+        filter.interpolatorState = 0.0f;
     }
     
-    for (auto& reflection : earlyReflectionsR)
-    {
-        std::fill(reflection.buffer.begin(), reflection.buffer.end(), 0.0f);
-        reflection.readIndex = 0;
-        reflection.writeIndex = 0;
-    }
+    // Ранние отражения
+    earlyReflections.clearLazily();
     
-    // Pre-delay буферы
-    std::fill(preDelayBufferL.begin(), preDelayBufferL.end(), 0.0f);
-    std::fill(preDelayBufferR.begin(), preDelayBufferR.end(), 0.0f);
-    preDelayIndexL = 0;
-    preDelayIndexR = 0;
+    // Pre-delay буфер
+    preDelayLine.clearLazily();
+    
+    // Состояние детектора тишины
+    sleeping = false;
+    tailEnergy = 0.0f;
+    quietSamples = 0;
 }
 
 void ReverbEngine::setParameters(const Parameters& newParams)
 {
-    bool roomSizeChanged = (newParams.roomSize != params.roomSize);
-    
     params = newParams;
+    params.roomSize = MathUtils::clamp(params.roomSize, minRoomSize, maxRoomSize);
+    params.numCombFilters = juce::jlimit(minCombFilters, maxCombFilters, params.numCombFilters);
+    params.numAllPassFilters = juce::jlimit(0, maxAllPassFilters, params.numAllPassFilters);
+    params.crossfadeTime = juce::jlimit(minCrossfadeMs, maxCrossfadeMs, params.crossfadeTime);
     
+    // ИСПРАВЛЕНО: Не переинициализируем буферы для устранения треска -
+    // новый снимок только меняет цели задержек и коэффициенты
     if (isPrepared)
     {
-        // ИСПРАВЛЕНО: Не переинициализируем буферы для устранения треска
-        // Только изменяем времена задержек в существующих фильтрах
-        if (roomSizeChanged)
-        {
-            updateDelayTimes();
-            updateEarlyReflections();
-        }
-        
-        updateFilterParameters();
-        updatePreDelay();
-        updateEarlyReflections();
+        useInitialDamping = false;
+        publishParameters();
     }
 }
 
 void ReverbEngine::setRoomSize(float roomSizeM2)
 {
-    float oldRoomSize = params.roomSize;
-    params.roomSize = MathUtils::clamp(roomSizeM2, 10.0f, 10000.0f);
+    // Сеттеры вызываются периодически (таймер процессора) - снимок
+    // пересчитывается только при реальном изменении значения
+    const float newRoomSize = MathUtils::clamp(roomSizeM2, minRoomSize, maxRoomSize);
+    if (newRoomSize == params.roomSize)
+        return;
+    
+    params.roomSize = newRoomSize;
     
-    if (isPrepared && oldRoomSize != params.roomSize)
+    if (isPrepared)
     {
-        // ИСПРАВЛЕНО: Не переинициализируем фильтры - только изменяем времена задержек
-        updateDelayTimes();
-        updateEarlyReflections();
-        updateFilterParameters();
-        updateEarlyReflections();
+        useInitialDamping = false;
+        publishParameters();
     }
 }
 
 void ReverbEngine::setDecayTime(float decayTimeSeconds)
 {
-    params.decayTime = MathUtils::clamp(decayTimeSeconds, 0.1f, 20.0f);
+    const float newDecayTime = MathUtils::clamp(decayTimeSeconds, 0.1f, 20.0f);
+    if (newDecayTime == params.decayTime)
+        return;
+    
+    params.decayTime = newDecayTime;
     
     if (isPrepared)
     {
-        updateFilterParameters();
+        useInitialDamping = false;
+        publishParameters();
     }
 }
 
 void ReverbEngine::setDamping(float dampingPercent)
 {
-    params.damping = MathUtils::clamp(dampingPercent, 0.0f, 100.0f);
+    const float newDamping = MathUtils::clamp(dampingPercent, 0.0f, 100.0f);
+    if (newDamping == params.damping)
+        return;
+    
+    params.damping = newDamping;
+    
     if (isPrepared)
-        updateFilterParameters();
+    {
+        useInitialDamping = false;
+        publishParameters();
+    }
 }
 
 void ReverbEngine::setPreDelay(float preDelayMs)
 {
-    params.preDelay = MathUtils::clamp(preDelayMs, 0.0f, 500.0f);
+    const float newPreDelay = MathUtils::clamp(preDelayMs, 0.0f, maxPreDelayMs);
+    if (newPreDelay == params.preDelay)
+        return;
+    
+    params.preDelay = newPreDelay;
+    
     if (isPrepared)
-        updatePreDelay();
+        publishParameters();
 }
 
 void ReverbEngine::setStereoWidth(float widthPercent)
 {
-    params.stereoWidth = MathUtils::clamp(widthPercent, 0.0f, 150.0f);
+    const float newWidth = MathUtils::clamp(widthPercent, 0.0f, 150.0f);
+    if (newWidth == params.stereoWidth)
+        return;
+    
+    params.stereoWidth = newWidth;
+    
     if (isPrepared)
-        updateStereoMixing();
+        publishParameters();
 }
 
 void ReverbEngine::setDryWetMix(float mixPercent)
 {
-    params.dryWetMix = juce::jlimit(0.0f, 100.0f, mixPercent);
+    const float newMix = juce::jlimit(0.0f, 100.0f, mixPercent);
+    if (newMix == params.dryWetMix)
+        return;
+    
+    params.dryWetMix = newMix;
+    
+    if (isPrepared)
+        publishParameters();
+}
+
+void ReverbEngine::setInterpolationMode(InterpolationMode newMode)
+{
+    if (newMode == params.interpolation)
+        return;
+    
+    params.interpolation = newMode;
+    
+    if (isPrepared)
+        publishParameters();
+}
+
+void ReverbEngine::setDelayTransition(DelayTransition newTransition)
+{
+    if (newTransition == params.delayTransition)
+        return;
+    
+    params.delayTransition = newTransition;
+    
+    if (isPrepared)
+        publishParameters();
+}
+
+void ReverbEngine::setCrossfadeTime(float crossfadeMs)
+{
+    const float newCrossfadeTime = juce::jlimit(minCrossfadeMs, maxCrossfadeMs, crossfadeMs);
+    if (newCrossfadeTime == params.crossfadeTime)
+        return;
+    
+    params.crossfadeTime = newCrossfadeTime;
+    
+    if (isPrepared)
+        publishParameters();
+}
+
+void ReverbEngine::setNumCombFilters(int numCombs)
+{
+    const int newNumCombs = juce::jlimit(minCombFilters, maxCombFilters, numCombs);
+    if (newNumCombs == params.numCombFilters)
+        return;
+    
+    params.numCombFilters = newNumCombs;
+    
+    if (isPrepared)
+        publishParameters();
+}
+
+void ReverbEngine::setNumAllPassFilters(int numAllPasses)
+{
+    const int newNumAllPasses = juce::jlimit(0, maxAllPassFilters, numAllPasses);
+    if (newNumAllPasses == params.numAllPassFilters)
+        return;
+    
+    params.numAllPassFilters = newNumAllPasses;
+    
+    if (isPrepared)
+        publishParameters();
+}
+
+void ReverbEngine::setTopology(const ReverbTopology& topology)
+{
+    const int newNumCombs = juce::jlimit(minCombFilters, maxCombFilters, topology.numCombs);
+    const int newNumAllPasses = juce::jlimit(0, maxAllPassFilters, topology.numAllPasses);
+    if (newNumCombs == params.numCombFilters && newNumAllPasses == params.numAllPassFilters)
+        return;
+    
+    params.numCombFilters = newNumCombs;
+    params.numAllPassFilters = newNumAllPasses;
+    
     if (isPrepared)
-        updateStereoMixing();
+        publishParameters();
 }
 
 //==============================================================================
@@ -342,140 +592,92 @@ float ReverbEngine::calculateRoomScale(float roomSize)
     return MathUtils::clamp(scale, 0.2f, 2.5f);
 }
 
-std::vector<int> ReverbEngine::getScaledCombDelays(bool isRightChannel)
+ReverbTopologies::DelayTable ReverbEngine::getScaledCombDelays(float roomSize, int numCombs, bool isRightChannel) const
 {
     // ИСПРАВЛЕНО: Более реалистичные времена задержек с учетом физики помещения
     // Классические времена задержек но с учетом размера комнаты
     // Маленькая комната: 10-15ms (быстрые отражения от близких стен)
     // Большая комната: 100-150ms (медленные отражения от далеких стен)
+    // Таблицы на 6 фильтров растягиваются на numCombs точек того же диапазона,
+    // задержки сдвигаются к взаимно простым - совпадающих резонансов нет
+    const float roomScale = calculateRoomScale(roomSize);
     
-    std::vector<float> baseDelayTimesMs;
-    float roomScale = calculateRoomScale(params.roomSize);
+    // Для правого канала добавляем stereoSpread (декорреляция)
+    const int offset = isRightChannel ? params.stereoSpread : 0;
     
     if (roomScale < 0.5f) // Маленькая комната
-    {
-        // Быстрые, плотные отражения
-        baseDelayTimesMs = {10.0f, 12.0f, 15.0f, 18.0f, 21.0f, 24.0f};
-    }
-    else if (roomScale < 1.5f) // Средняя комната
-    {
-        // Классические времена Schroeder
-        baseDelayTimesMs = {29.7f, 37.1f, 41.1f, 43.7f, 50.0f, 56.0f};
-    }
-    else // Большая комната
-    {
-        // Медленные, разреженные отражения
-        baseDelayTimesMs = {70.0f, 83.0f, 97.0f, 111.0f, 127.0f, 142.0f};
-    }
+        return ReverbTopologies::makeDelayTable(ReverbTopologies::smallRoomCombMs, numCombs, roomScale, sampleRate, offset, 1);
     
-    std::vector<int> delaySamples;
-    for (float baseDelayMs : baseDelayTimesMs)
-    {
-        float scaledDelayMs = baseDelayMs * roomScale;
-        int samples = static_cast<int>((scaledDelayMs / 1000.0f) * sampleRate);
-        
-        // Для правого канала добавляем stereoSpread (декорреляция)
-        if (isRightChannel)
-        {
-            samples += params.stereoSpread;
-        }
-        
-        delaySamples.push_back(samples);
-    }
+    if (roomScale < 1.5f) // Средняя комната
+        return ReverbTopologies::makeDelayTable(ReverbTopologies::mediumRoomCombMs, numCombs, roomScale, sampleRate, offset, 1);
     
-    return delaySamples;
+    // Большая комната
+    return ReverbTopologies::makeDelayTable(ReverbTopologies::largeRoomCombMs, numCombs, roomScale, sampleRate, offset, 1);
 }
 
-std::vector<int> ReverbEngine::getScaledAllPassDelays(bool isRightChannel)
+ReverbTopologies::DelayTable ReverbEngine::getScaledAllPassDelays(float roomSize, int numAllPasses, bool isRightChannel) const
 {
     // ИСПРАВЛЕНО: Максимально уменьшенные времена задержек для полного устранения delay эффекта
     // Профессиональные allpass фильтры используют очень малые задержки: 1-3ms
     // Было: 8ms и 15ms - все еще слишком много!
     // Стало: 2ms и 4ms - ниже порога восприятия delay (5ms)
-    std::vector<float> baseDelayTimesMs = {2.0f, 4.0f}; // Было {8.0f, 15.0f}
+    // ИСПРАВЛЕНО: Минимальная задержка должна быть хотя бы 1 сэмпл
+    const int offset = isRightChannel ? params.stereoSpread : 0;
     
-    float roomScale = calculateRoomScale(params.roomSize);
+    return ReverbTopologies::makeDelayTable(ReverbTopologies::allPassMs, numAllPasses,
+                                            calculateRoomScale(roomSize), sampleRate, offset, 1);
+}
+
+int ReverbEngine::getLongestCombDelay(bool isRightChannel) const
+{
+    // Худший случай по всем допустимым числам фильтров: после растяжения
+    // таблицы и сдвига к взаимно простым задержкам максимум зависит от числа
+    int longest = 1;
     
-    std::vector<int> delaySamples;
-    for (float baseDelayMs : baseDelayTimesMs)
+    for (int numCombs = minCombFilters; numCombs <= maxCombFilters; ++numCombs)
     {
-        float scaledDelayMs = baseDelayMs * roomScale;
-        int samples = static_cast<int>((scaledDelayMs / 1000.0f) * sampleRate);
-        
-        // Для правого канала добавляем stereoSpread (декорреляция)
-        if (isRightChannel)
-        {
-            samples += params.stereoSpread;
-        }
-        
-        // ИСПРАВЛЕНО: Минимальная задержка должна быть хотя бы 1 сэмпл
-        samples = std::max(samples, 1);
-        
-        delaySamples.push_back(samples);
+        const auto delays = getScaledCombDelays(maxRoomSize, numCombs, isRightChannel);
+        longest = std::max(longest, *std::max_element(delays.begin(), delays.begin() + numCombs));
+    }
+    
+    return longest;
+}
+
+int ReverbEngine::getLongestAllPassDelay(bool isRightChannel) const
+{
+    int longest = 1;
+    
+    for (int numAllPasses = 1; numAllPasses <= maxAllPassFilters; ++numAllPasses)
+    {
+        const auto delays = getScaledAllPassDelays(maxRoomSize, numAllPasses, isRightChannel);
+        longest = std::max(longest, *std::max_element(delays.begin(), delays.begin() + numAllPasses));
     }
     
-    return delaySamples;
+    return longest;
 }
 
-std::vector<float> ReverbEngine::getEarlyReflectionDelays(bool isRightChannel)
+std::array<float, ReverbEngine::numEarlyReflections> ReverbEngine::getEarlyReflectionDelays(bool isRightChannel) const
 {
     // ИСПРАВЛЕНО: Создаем более плотную структуру отражений для устранения delay эффекта
     // Профессиональные early reflections: плотная структура 3-25ms
     float roomScale = calculateRoomScale(params.roomSize);
     float baseDelay = 3.0f + 12.0f * roomScale; // 3-15ms базовая задержка (было 5-35ms)
     
-    std::vector<float> delays;
-    // Создаем 8 отражений с малыми промежутками для более плотной структуры
-    delays.push_back(baseDelay);           // 1-е отражение: 3-15ms
-    delays.push_back(baseDelay * 1.15f);   // 2-е отражение: +15% (малый промежуток)
-    delays.push_back(baseDelay * 1.35f);   // 3-е отражение: +35%
-    delays.push_back(baseDelay * 1.58f);   // 4-е отражение: +58%
-    delays.push_back(baseDelay * 1.84f);   // 5-е отражение: +84%
-    delays.push_back(baseDelay * 2.12f);   // 6-е отражение: +112%
-    delays.push_back(baseDelay * 2.43f);   // 7-е отражение: +143%
-    delays.push_back(baseDelay * 2.77f);   // 8-е отражение: +177%
-    
     // Для правого канала добавляем небольшую декорреляцию
-    if (isRightChannel)
-    {
-        float spreadMs = (params.stereoSpread / sampleRate) * 1000.0f;
-        for (auto& delay : delays)
-        {
-            delay += spreadMs * 0.5f; // Уменьшаем декорреляцию для более плотной структуры
-        }
-    }
+    // (уменьшенную для более плотной структуры)
+    const float spreadMs = isRightChannel ? (params.stereoSpread / sampleRate) * 1000.0f * 0.5f : 0.0f;
     
-    // ИСПРАВЛЕНО: Ограничиваем максимум для более плотной структуры
-    for (auto& delay : delays)
-    {
-        delay = MathUtils::clamp(delay, 3.0f, 45.0f); // Было 5-80ms, стало 3-45ms
-    }
+    // Таблица фиксированного размера - вызывается при каждой публикации снимка
+    std::array<float, numEarlyReflections> delays {};
     
-    return delays;
-}
-
-bool ReverbEngine::areMutuallyPrime(const std::vector<int>& delays)
-{
     for (size_t i = 0; i < delays.size(); ++i)
     {
-        for (size_t j = i + 1; j < delays.size(); ++j)
-        {
-            if (gcd(delays[i], delays[j]) != 1)
-                return false;
-        }
-    }
-    return true;
-}
-
-int ReverbEngine::gcd(int a, int b)
-{
-    while (b != 0)
-    {
-        int temp = b;
-        b = a % b;
-        a = temp;
+        // ИСПРАВЛЕНО: Ограничиваем максимум для более плотной структуры (3-45ms)
+        const float delay = baseDelay * ReverbTopologies::earlyReflectionRatios[i] + spreadMs;
+        delays[i] = MathUtils::clamp(delay, 3.0f, maxEarlyReflectionMs);
     }
-    return a;
+    
+    return delays;
 }
 
 float ReverbEngine::calculateFeedback(float decayTime, double sampleRate)
@@ -506,11 +708,10 @@ void ReverbEngine::logFeedbackValues() const
     std::cout << "DecayTime: " << params.decayTime << "s" << std::endl;
     std::cout << "RoomSize: " << params.roomSize << "m²" << std::endl;
     
-    for (size_t i = 0; i < combFilters.size(); ++i)
+    for (int i = 0; i < combBank.getNumCombsPerChannel(); ++i)
     {
-        const auto& filter = combFilters[i];
-        float delayMs = (static_cast<float>(filter.delayTime) / static_cast<float>(sampleRate)) * 1000.0f;
-        std::cout << "Comb[" << i << "]: delay=" << delayMs << "ms, feedback=" << filter.feedback << std::endl;
+        float delayMs = (combBank.getTargetDelay(0, i) / static_cast<float>(sampleRate)) * 1000.0f;
+        std::cout << "Comb[" << i << "]: delay=" << delayMs << "ms, feedback=" << combBank.getFeedback(0, i) << std::endl;
     }
     std::cout << "=========================" << std::endl;
 }
@@ -525,12 +726,11 @@ void ReverbEngine::logReverbState() const
     std::vector<float> feedbacks;
     std::vector<float> delayTimes;
     
-    for (size_t i = 0; i < combFiltersL.size(); ++i)
+    for (int i = 0; i < combBank.getNumCombsPerChannel(); ++i)
     {
-        const auto& filter = combFiltersL[i];
-        float delayMs = (static_cast<float>(filter.delayTime) / static_cast<float>(sampleRate)) * 1000.0f;
+        float delayMs = (combBank.getTargetDelay(0, i) / static_cast<float>(sampleRate)) * 1000.0f;
         
-        feedbacks.push_back(filter.feedback);
+        feedbacks.push_back(combBank.getFeedback(0, i));
         delayTimes.push_back(delayMs);
     }
     
@@ -544,554 +744,541 @@ void ReverbEngine::logReverbState() const
 
 void ReverbEngine::initializeCombFilters()
 {
-    // Инициализация левого канала
-    combFiltersL.clear();
-    combFiltersL.resize(6); // Фиксированное количество по Schroeder
-    
-    auto delaysL = getScaledCombDelays(false);
+    // params.numCombFilters comb фильтров на каждый из двух каналов
+    combBank.prepare(params.numCombFilters, 2);
     
-    for (size_t i = 0; i < combFiltersL.size(); ++i)
+    for (int channel = 0; channel < 2; ++channel)
     {
-        auto& filter = combFiltersL[i];
-        
-        int delayTime = delaysL[i];
-        int bufferSize = delayTime + blockSize;
-        
-        filter.buffer.resize(bufferSize, 0.0f);
-        filter.delayTime = delayTime;
-        filter.readIndex = 0;
-        filter.writeIndex = 0;
+        auto delays = getScaledCombDelays(params.roomSize, params.numCombFilters, channel == 1);
         
-        // Рассчитываем feedback на основе decay time
-        filter.feedback = calculateFeedback(params.decayTime, sampleRate);
+        // Память всех дорожек - под самую большую комнату и любое число фильтров:
+        // автоматизация roomSize и смена топологии не выделяют
+        const int longestDelay = getLongestCombDelay(channel == 1);
         
-        // Damping коэффициент
-        filter.damping = params.damping / 100.0f;
+        for (int i = 0; i < maxCombFilters; ++i)
+            combBank.setMaximumDelay(channel, i, longestDelay, delayMemory);
         
-        // Gain управление
-        filter.outputGain = 1.0f;
-        filter.targetOutputGain = 1.0f;
-        filter.fadeRemaining = 0;
-        
-        // Инициализация новых полей для плавного перехода
-        filter.pendingParameterChange = false;
-        filter.newDelayTime = 0;
-        filter.newBufferSize = 0;
-        
-        // Инициализация fractional delay
-        filter.currentDelayTime = static_cast<float>(delayTime);
-        filter.targetDelayTime = static_cast<float>(delayTime);
-        filter.delayChangeRate = 0.0f;
+        for (int i = 0; i < combBank.getNumCombsPerChannel(); ++i)
+        {
+            int delayTime = delays[static_cast<size_t>(i)];
+            
+            // Инициализация fractional delay
+            combBank.setDelay(channel, i, static_cast<float>(delayTime));
+        }
     }
     
-    // Инициализация правого канала
-    combFiltersR.clear();
-    combFiltersR.resize(6); // Фиксированное количество по Schroeder
-    
-    auto delaysR = getScaledCombDelays(true);
+    // Рассчитываем feedback на основе decay time
+    combBank.setFeedback(calculateFeedback(params.decayTime, sampleRate));
     
-    for (size_t i = 0; i < combFiltersR.size(); ++i)
-    {
-        auto& filter = combFiltersR[i];
-        
-        int delayTime = delaysR[i];
-        int bufferSize = delayTime + blockSize;
-        
-        filter.buffer.resize(bufferSize, 0.0f);
-        filter.delayTime = delayTime;
-        filter.readIndex = 0;
-        filter.writeIndex = 0;
-        
-        // Рассчитываем feedback на основе decay time
-        filter.feedback = calculateFeedback(params.decayTime, sampleRate);
-        
-        // Damping коэффициент
-        filter.damping = params.damping / 100.0f;
-        
-        // Gain управление
-        filter.outputGain = 1.0f;
-        filter.targetOutputGain = 1.0f;
-        filter.fadeRemaining = 0;
-        
-        // Инициализация новых полей для плавного перехода
-        filter.pendingParameterChange = false;
-        filter.newDelayTime = 0;
-        filter.newBufferSize = 0;
-        
-        // Инициализация fractional delay
-        filter.currentDelayTime = static_cast<float>(delayTime);
-        filter.targetDelayTime = static_cast<float>(delayTime);
-        filter.delayChangeRate = 0.0f;
-    }
+    // Damping коэффициент
+    combBank.setDamping(params.damping / 100.0f);
 }
 
 void ReverbEngine::initializeAllPassFilters()
 {
-    // Инициализация левого канала
-    allPassFiltersL.clear();
-    allPassFiltersL.resize(2); // Фиксированное количество по Schroeder
+    // Записи и память - под максимум фильтров, активны первые params.numAllPassFilters
+    numActiveAllPassFilters = params.numAllPassFilters;
     
-    auto delaysL = getScaledAllPassDelays(false);
+    AllPassChain* channels[] = { &allPassFiltersL, &allPassFiltersR };
     
-    for (size_t i = 0; i < allPassFiltersL.size(); ++i)
+    for (int channel = 0; channel < 2; ++channel)
     {
-        auto& filter = allPassFiltersL[i];
-        
-        int delayTime = delaysL[i];
-        int bufferSize = delayTime + blockSize;
-        
-        filter.buffer.resize(bufferSize, 0.0f);
-        filter.delayTime = delayTime;
-        filter.readIndex = 0;
-        filter.writeIndex = 0;
-        
-        // Фиксированный коэффициент обратной связи для all-pass фильтра
-        filter.feedback = 0.5f;
-        
-        // Gain управление
-        filter.outputGain = 1.0f;
-        filter.targetOutputGain = 1.0f;
-        filter.fadeRemaining = 0;
+        auto& filters = *channels[channel];
+        filters.fill(AllPassFilter());
         
-        // Инициализация новых полей для плавного перехода
-        filter.pendingParameterChange = false;
-        filter.newDelayTime = 0;
-        filter.newBufferSize = 0;
+        auto delays = getScaledAllPassDelays(params.roomSize, numActiveAllPassFilters, channel == 1);
+        const int longestDelay = getLongestAllPassDelay(channel == 1);
         
-        // Инициализация fractional delay
-        filter.currentDelayTime = static_cast<float>(delayTime);
-        filter.targetDelayTime = static_cast<float>(delayTime);
-        filter.delayChangeRate = 0.0f;
+        for (size_t i = 0; i < filters.size(); ++i)
+        {
+            auto& filter = filters[i];
+            
+            filter.line.setMaximumDelay(longestDelay, delayMemory);
+            
+            // Фиксированный коэффициент обратной связи для all-pass фильтра
+            filter.feedback = 0.5f;
+            
+            // Инициализация fractional delay (у неактивных - при включении)
+            if (i < static_cast<size_t>(numActiveAllPassFilters))
+            {
+                filter.currentDelayTime = static_cast<float>(delays[i]);
+                filter.targetDelayTime = static_cast<float>(delays[i]);
+            }
+            
+            filter.delayChangeRate = 0.0f;
+        }
     }
+}
+
+void ReverbEngine::initializeEarlyReflections()
+{
+    // Одна линия на моно-вход, память - под максимальную задержку отражений,
+    // поэтому изменение roomSize только переписывает таблицу отводов
+    const int maxDelaySamples = static_cast<int>(std::ceil((maxEarlyReflectionMs / 1000.0f) * sampleRate)) + 1;
+    earlyReflections.prepare(maxDelaySamples, blockSize, 2, delayMemory);
     
-    // Инициализация правого канала
-    allPassFiltersR.clear();
-    allPassFiltersR.resize(2); // Фиксированное количество по Schroeder
+    for (int channel = 0; channel < 2; ++channel)
+        earlyReflections.setNumTaps(channel, numEarlyReflections);
+}
+
+void ReverbEngine::initializePreDelay()
+{
+    const int maxDelaySamples = static_cast<int>(std::ceil((maxPreDelayMs / 1000.0f) * sampleRate));
+    preDelayLine.setMaximumDelay(maxDelaySamples, delayMemory);
+    preDelayWasBypassed = true;
+}
+
+//==============================================================================
+// Снимок параметров: расчет (поток сеттеров)
+//==============================================================================
+
+void ReverbEngine::publishParameters()
+{
+    // Слот записи содержит снимок двухшаговой давности - заполняем целиком
+    DerivedParameters& derived = parameterSnapshots.getWriteBuffer();
     
-    auto delaysR = getScaledAllPassDelays(true);
+    computeFilterParameters(derived);
+    computeDelayTimes(derived);
+    computeEarlyReflections(derived);
+    computePreDelay(derived);
+    computeStereoMixing(derived);
     
-    for (size_t i = 0; i < allPassFiltersR.size(); ++i)
+    parameterSnapshots.publish();
+}
+
+void ReverbEngine::computeFilterParameters(DerivedParameters& derived) const
+{
+    // Топология сети
+    derived.numCombFilters = params.numCombFilters;
+    derived.numAllPassFilters = params.numAllPassFilters;
+    
+    // Параметры comb фильтров (оба канала)
+    derived.combFeedback = calculateFeedback(params.decayTime, sampleRate);
+    derived.interpolation = params.interpolation;
+    derived.delayTransition = params.delayTransition;
+    derived.crossfadeSamples = juce::jmax(1, static_cast<int>((params.crossfadeTime / 1000.0f) * sampleRate));
+    
+    // ИСПРАВЛЕНО: Damping должен быть очень маленьким (1-5%), не 50%!
+    // В профессиональных spreadra damping - это слабое ослабление высоких частот
+    // params.damping диапазон 0-100%, но используем только 0-5% для реального damping
+    float dampingNormalized = MathUtils::clamp(params.damping / 100.0f, 0.0f, 1.0f);
+    derived.combDamping = useInitialDamping ? params.damping / 100.0f
+                                            : dampingNormalized * 0.05f; // Максимум 5% damping, не 100%!
+    
+    // Стандартное значение для all-pass фильтров
+    derived.allPassFeedback = 0.5f;
+}
+
+void ReverbEngine::computeDelayTimes(DerivedParameters& derived) const
+{
+    // НОВЫЙ ПОДХОД: Плавное изменение времени задержки как у DecayTime -
+    // здесь только цели, переход выполняет аудио-поток в applyDelayTimes()
+    for (int channel = 0; channel < 2; ++channel)
     {
-        auto& filter = allPassFiltersR[i];
-        
-        int delayTime = delaysR[i];
-        int bufferSize = delayTime + blockSize;
-        
-        filter.buffer.resize(bufferSize, 0.0f);
-        filter.delayTime = delayTime;
-        filter.readIndex = 0;
-        filter.writeIndex = 0;
-        
-        // Фиксированный коэффициент обратной связи для all-pass фильтра
-        filter.feedback = 0.5f;
+        auto combDelays = getScaledCombDelays(params.roomSize, params.numCombFilters, channel == 1);
+        auto allPassDelays = getScaledAllPassDelays(params.roomSize, params.numAllPassFilters, channel == 1);
         
-        // Gain управление
-        filter.outputGain = 1.0f;
-        filter.targetOutputGain = 1.0f;
-        filter.fadeRemaining = 0;
+        // Линии выделены в prepare() под maxRoomSize - цель только ограничивается
+        for (size_t i = 0; i < static_cast<size_t>(params.numCombFilters); ++i)
+        {
+            const int maxDelay = combBank.getMaximumDelay(channel, static_cast<int>(i));
+            derived.combDelays[static_cast<size_t>(channel)][i] = static_cast<float>(juce::jmin(combDelays[i], maxDelay));
+        }
         
-        // Инициализация новых полей для плавного перехода
-        filter.pendingParameterChange = false;
-        filter.newDelayTime = 0;
-        filter.newBufferSize = 0;
+        const auto& filters = channel == 0 ? allPassFiltersL : allPassFiltersR;
         
-        // Инициализация fractional delay
-        filter.currentDelayTime = static_cast<float>(delayTime);
-        filter.targetDelayTime = static_cast<float>(delayTime);
-        filter.delayChangeRate = 0.0f;
+        for (size_t i = 0; i < static_cast<size_t>(params.numAllPassFilters); ++i)
+        {
+            const int maxDelay = filters[i].line.getMaximumDelay();
+            derived.allPassDelays[static_cast<size_t>(channel)][i] = static_cast<float>(juce::jmin(allPassDelays[i], maxDelay));
+        }
     }
 }
 
-void ReverbEngine::initializeEarlyReflections()
+void ReverbEngine::computeEarlyReflections(DerivedParameters& derived) const
 {
-    // Инициализация левого канала
-    earlyReflectionsL.clear();
-    earlyReflectionsL.resize(8); // 8 early reflections (было 6)
-    
-    auto reflectionDelaysL = getEarlyReflectionDelays(false);
-    
-    // Расчет размеров буферов для early reflections
-    for (size_t i = 0; i < earlyReflectionsL.size() && i < reflectionDelaysL.size(); ++i)
+    // Отводы левого (0) и правого (1) канала
+    for (int channel = 0; channel < 2; ++channel)
     {
-        auto& reflection = earlyReflectionsL[i];
-        
-        int delayTimeSamples = static_cast<int>((reflectionDelaysL[i] / 1000.0f) * sampleRate);
-        int bufferSize = delayTimeSamples + blockSize;
+        const auto reflectionDelays = getEarlyReflectionDelays(channel == 1);
+        auto& taps = derived.reflections[static_cast<size_t>(channel)];
         
-        reflection.buffer.resize(bufferSize, 0.0f);
-        reflection.delayTime = delayTimeSamples;
-        reflection.readIndex = 0;
-        reflection.writeIndex = 0;
-        
-        // ИСПРАВЛЕНО: Намного более тихие early reflections с плавным затуханием
-        reflection.gain = 0.018f / (static_cast<float>(i + 1)); // 0.018, 0.009, 0.006, 0.0045... (еще тише)
+        for (int i = 0; i < numEarlyReflections; ++i)
+        {
+            auto& tap = taps[static_cast<size_t>(i)];
+            tap.delaySamples = static_cast<int>((reflectionDelays[static_cast<size_t>(i)] / 1000.0f) * sampleRate);
+            
+            // ИСПРАВЛЕНО: Намного более тихие early reflections с плавным затуханием
+            tap.gain = 0.018f / (static_cast<float>(i + 1)); // 0.018, 0.009, 0.006, 0.0045... (еще тише)
+        }
     }
+}
+
+void ReverbEngine::computePreDelay(DerivedParameters& derived) const
+{
+    // Буфер не трогаем - он выделен в prepare() под максимальную задержку
+    int samples = static_cast<int>((params.preDelay / 1000.0f) * sampleRate);
+    derived.preDelaySamples = MathUtils::clamp(samples, 0, preDelayLine.getMaximumDelay()); // Макс 0.5 секунды
+}
+
+void ReverbEngine::computeStereoMixing(DerivedParameters& derived) const
+{
+    // Freeverb-style стерео микширование с исправленными коэффициентами
+    float effectMix = params.dryWetMix / 100.0f;  // 0-1
+    float width = params.stereoWidth / 100.0f;    // 0-1.5
+    
+    // ИСПРАВЛЕНО: Уменьшенные коэффициенты для предотвращения перегруза
+    const float scaleWet = 1.0f;  // Было 3.0f - слишком много!
+    const float scaleDry = 1.0f;  // Было 2.0f - слишком много!
+    
+    float wet1_calc = scaleWet * effectMix;
+    float dry1_calc = scaleDry * (1.0f - effectMix);
+    
+    float wet_total = wet1_calc / (wet1_calc + dry1_calc);
+    float dry_total = dry1_calc / (wet1_calc + dry1_calc);
     
-    // Инициализация правого канала
-    earlyReflectionsR.clear();
-    earlyReflectionsR.resize(8); // 8 early reflections (было 6)
+    // Стерео ширина влияет на cross-mixing
+    float newWet1 = wet_total * (width / 2.0f + 0.5f);
+    float newWet2 = wet_total * (1.0f - width) / 2.0f;
+    float newDry = dry_total;
     
-    auto reflectionDelaysR = getEarlyReflectionDelays(true);
+    // ИСПРАВЛЕНО: Более строгие ограничения + общая нормализация
+    newWet1 = MathUtils::clamp(newWet1, 0.0f, 1.0f);
+    newWet2 = MathUtils::clamp(newWet2, 0.0f, 1.0f);
+    newDry = MathUtils::clamp(newDry, 0.0f, 1.0f);
     
-    // Расчет размеров буферов для early reflections
-    for (size_t i = 0; i < earlyReflectionsR.size() && i < reflectionDelaysR.size(); ++i)
+    // Общая нормализация для предотвращения перегруза
+    float totalGain = newWet1 + newWet2 + newDry;
+    if (totalGain > 1.0f)
     {
-        auto& reflection = earlyReflectionsR[i];
-        
-        int delayTimeSamples = static_cast<int>((reflectionDelaysR[i] / 1000.0f) * sampleRate);
-        int bufferSize = delayTimeSamples + blockSize;
-        
-        reflection.buffer.resize(bufferSize, 0.0f);
-        reflection.delayTime = delayTimeSamples;
-        reflection.readIndex = 0;
-        reflection.writeIndex = 0;
-        
-        // ИСПРАВЛЕНО: Намного более тихие early reflections с плавным затуханием
-        reflection.gain = 0.018f / (static_cast<float>(i + 1)); // 0.018, 0.009, 0.006, 0.0045... (еще тише)
+        newWet1 /= totalGain;
+        newWet2 /= totalGain;
+        newDry /= totalGain;
     }
+    
+    derived.wet1 = newWet1;
+    derived.wet2 = newWet2;
+    derived.dry = newDry;
 }
 
-void ReverbEngine::updateFilterParameters()
+//==============================================================================
+// Снимок параметров: применение (аудио-поток)
+//==============================================================================
+
+void ReverbEngine::pullParameters()
 {
-    if (!isPrepared)
-        return;
+    if (parameterSnapshots.acquire())
+        applyParameters(parameterSnapshots.read());
+}
+
+void ReverbEngine::applyParameters(const DerivedParameters& derived)
+{
+    applyTopology(derived);
     
-    // Обновляем параметры comb фильтров
-    for (auto& filter : combFiltersL)
-    {
-        filter.feedback = calculateFeedback(params.decayTime, sampleRate);
-        
-        // ИСПРАВЛЕНО: Damping должен быть очень маленьким (1-5%), не 50%!
-        // В профессиональных spreadra damping - это слабое ослабление высоких частот
-        // params.damping диапазон 0-100%, но используем только 0-5% для реального damping
-        float dampingNormalized = MathUtils::clamp(params.damping / 100.0f, 0.0f, 1.0f);
-        filter.damping = dampingNormalized * 0.05f; // Максимум 5% damping, не 100%!
-    }
+    // Comb фильтры обоих каналов
+    combBank.setFeedback(derived.combFeedback);
+    combBank.setDamping(derived.combDamping);
+    combBank.setInterpolationMode(derived.interpolation);
+    interpolation = derived.interpolation;
     
-    for (auto& filter : combFiltersR)
+    // Смена способа перехода: идущие glide/кроссфейды завершаются сразу,
+    // чтобы каждое ядро видело только свой вид перехода
+    if (derived.delayTransition != delayTransition)
     {
-        filter.feedback = calculateFeedback(params.decayTime, sampleRate);
+        combBank.finishTransitions();
+        
+        for (auto* filters : { &allPassFiltersL, &allPassFiltersR })
+        {
+            for (auto& filter : *filters)
+            {
+                filter.currentDelayTime = filter.targetDelayTime;
+                filter.delayChangeRate = 0.0f;
+                filter.fadeStep = 0.0f;
+            }
+        }
         
-        // ИСПРАВЛЕНО: Damping должен быть очень маленьким (1-5%), не 50%!
-        // В профессиональных spreadra damping - это слабое ослабление высоких частот
-        // params.damping диапазон 0-100%, но используем только 0-5% для реального damping
-        float dampingNormalized = MathUtils::clamp(params.damping / 100.0f, 0.0f, 1.0f);
-        filter.damping = dampingNormalized * 0.05f; // Максимум 5% damping, не 100%!
+        delayTransition = derived.delayTransition;
     }
     
-    // Обновляем параметры all-pass фильтров
-    for (auto& filter : allPassFiltersL)
-    {
-        filter.feedback = 0.5f; // Стандартное значение для all-pass фильтров
-    }
+    crossfadeSamples = derived.crossfadeSamples;
     
-    for (auto& filter : allPassFiltersR)
+    // All-pass фильтры
+    for (auto* filters : { &allPassFiltersL, &allPassFiltersR })
+        for (auto& filter : *filters)
+            filter.feedback = derived.allPassFeedback;
+    
+    applyDelayTimes(derived);
+    
+    // Ранние отражения
+    for (int channel = 0; channel < earlyReflections.getNumOutputs(); ++channel)
     {
-        filter.feedback = 0.5f; // Стандартное значение для all-pass фильтров
+        for (int i = 0; i < numEarlyReflections; ++i)
+        {
+            const auto& tap = derived.reflections[static_cast<size_t>(channel)][static_cast<size_t>(i)];
+            earlyReflections.setTap(channel, i, tap.delaySamples, tap.gain);
+        }
     }
-}
-
-void ReverbEngine::updatePreDelay()
-{
-    preDelaySamples = static_cast<int>((params.preDelay / 1000.0f) * sampleRate);
-    preDelaySamples = MathUtils::clamp(preDelaySamples, 0, static_cast<int>(0.5f * sampleRate)); // Макс 0.5 секунды
     
-    // Инициализация левого канала pre-delay
-    size_t bufferSize = preDelaySamples + blockSize;
-    preDelayBufferL.resize(bufferSize, 0.0f);
-    preDelayIndexL = 0;
+    preDelaySamples = derived.preDelaySamples;
     
-    // Инициализация правого канала pre-delay
-    preDelayBufferR.resize(bufferSize, 0.0f);
-    preDelayIndexR = 0;
+    wet1 = derived.wet1;
+    wet2 = derived.wet2;
+    dry = derived.dry;
 }
 
-void ReverbEngine::updateEarlyReflections()
+void ReverbEngine::applyTopology(const DerivedParameters& derived)
 {
-    // Левый канал
-    auto reflectionDelaysL = getEarlyReflectionDelays(false);
-    
-    for (size_t i = 0; i < earlyReflectionsL.size() && i < reflectionDelaysL.size(); ++i)
-    {
-        auto& reflection = earlyReflectionsL[i];
-        
-        int newDelayTime = static_cast<int>((reflectionDelaysL[i] / 1000.0f) * sampleRate);
-        newDelayTime = MathUtils::clamp(newDelayTime, 1, static_cast<int>(reflection.buffer.size() - 1));
-        
-        reflection.delayTime = newDelayTime;
-        reflection.gain = 0.018f / (static_cast<float>(i + 1)); // Убывающий gain
-    }
+    // Память всех фильтров выделена в prepare(): меняются только счетчики.
+    // Включенные фильтры стартуют с чистой линией, задержку им задает applyDelayTimes()
+    combBank.setNumCombsPerChannel(derived.numCombFilters);
     
-    // Правый канал
-    auto reflectionDelaysR = getEarlyReflectionDelays(true);
+    const int newNumAllPasses = juce::jlimit(0, maxAllPassFilters, derived.numAllPassFilters);
     
-    for (size_t i = 0; i < earlyReflectionsR.size() && i < reflectionDelaysR.size(); ++i)
+    for (auto* filters : { &allPassFiltersL, &allPassFiltersR })
     {
-        auto& reflection = earlyReflectionsR[i];
-        
-        int newDelayTime = static_cast<int>((reflectionDelaysR[i] / 1000.0f) * sampleRate);
-        newDelayTime = MathUtils::clamp(newDelayTime, 1, static_cast<int>(reflection.buffer.size() - 1));
-        
-        reflection.delayTime = newDelayTime;
-        reflection.gain = 0.018f / (static_cast<float>(i + 1)); // Убывающий gain
+        for (int i = numActiveAllPassFilters; i < newNumAllPasses; ++i)
+        {
+            auto& filter = (*filters)[static_cast<size_t>(i)];
+            filter.line.clearLazily();
+            filter.interpolatorState = 0.0f;
+            filter.currentDelayTime = 0.0f;
+            filter.targetDelayTime = 0.0f;
+            filter.delayChangeRate = 0.0f;
+            filter.fadeStep = 0.0f;
+        }
     }
+    
+    numActiveAllPassFilters = newNumAllPasses;
 }
 
-//==============================================================================
-// ИСПРАВЛЕНО: Очистка буферов при изменении roomSize для устранения "памяти"
-//==============================================================================
-void ReverbEngine::updateDelayTimes()
+void ReverbEngine::applyDelayTimes(const DerivedParameters& derived)
 {
     // НОВЫЙ ПОДХОД: Плавное изменение времени задержки как у DecayTime
     // Используем fractional delay с интерполяцией - как в профессиональных spreadra
     
-    // Получаем новые времена задержек
-    auto newDelaysL = getScaledCombDelays(false);
-    auto newDelaysR = getScaledCombDelays(true);
-    auto newAllPassDelaysL = getScaledAllPassDelays(false);
-    auto newAllPassDelaysR = getScaledAllPassDelays(true);
-    
     // Скорость изменения задержки (чем меньше, тем плавнее)
     // 0.001 = очень медленно, 0.1 = быстро
     float delayTransitionSpeed = 0.01f; // 1% изменения за сэмпл
     
-    // Обновляем comb фильтры - левый канал
-    for (size_t i = 0; i < combFiltersL.size() && i < newDelaysL.size(); ++i)
+    // Обновляем comb фильтры - оба канала; переход запускается только при смене цели
+    for (int channel = 0; channel < combBank.getNumChannels(); ++channel)
     {
-        float newDelayTime = static_cast<float>(newDelaysL[i]);
-        
-        // Инициализация fractional delay при первом использовании
-        if (combFiltersL[i].currentDelayTime == 0.0f)
+        for (int i = 0; i < combBank.getNumCombsPerChannel(); ++i)
         {
-            combFiltersL[i].currentDelayTime = newDelayTime;
-            combFiltersL[i].targetDelayTime = newDelayTime;
-        }
-        else
-        {
-            // Устанавливаем новую цель для плавного перехода
-            combFiltersL[i].targetDelayTime = newDelayTime;
+            float newDelayTime = derived.combDelays[static_cast<size_t>(channel)][static_cast<size_t>(i)];
             
-            // Вычисляем скорость изменения
-            float delayDifference = combFiltersL[i].targetDelayTime - combFiltersL[i].currentDelayTime;
-            combFiltersL[i].delayChangeRate = delayDifference * delayTransitionSpeed;
-        }
-        
-        // Убеждаемся что буфер достаточно большой для любого времени задержки
-        size_t maxPossibleDelayTime = static_cast<size_t>(newDelayTime * 1.2f); // 20% запас
-        size_t requiredBufferSize = maxPossibleDelayTime + blockSize;
-        
-        if (combFiltersL[i].buffer.size() < requiredBufferSize)
-        {
-            combFiltersL[i].buffer.resize(requiredBufferSize, 0.0f);
+            if (newDelayTime == combBank.getTargetDelay(channel, i))
+                continue;
+            
+            // Память выделена в prepare() под maxRoomSize - здесь только смена цели
+            jassert(newDelayTime <= static_cast<float>(combBank.getMaximumDelay(channel, i)));
+            
+            // Устанавливаем новую цель для плавного перехода
+            if (delayTransition == DelayTransition::Crossfade)
+                combBank.crossfadeToDelay(channel, i, newDelayTime, crossfadeSamples);
+            else
+                combBank.glideToDelay(channel, i, newDelayTime, delayTransitionSpeed);
         }
     }
     
-    // Обновляем comb фильтры - правый канал
-    for (size_t i = 0; i < combFiltersR.size() && i < newDelaysR.size(); ++i)
+    // Обновляем allpass фильтры - оба канала
+    AllPassChain* allPassChannels[] = { &allPassFiltersL, &allPassFiltersR };
+    
+    for (size_t channel = 0; channel < 2; ++channel)
     {
-        float newDelayTime = static_cast<float>(newDelaysR[i]);
+        auto& filters = *allPassChannels[channel];
         
-        // Инициализация fractional delay при первом использовании
-        if (combFiltersR[i].currentDelayTime == 0.0f)
-        {
-            combFiltersR[i].currentDelayTime = newDelayTime;
-            combFiltersR[i].targetDelayTime = newDelayTime;
-        }
-        else
+        for (size_t i = 0; i < static_cast<size_t>(numActiveAllPassFilters); ++i)
         {
-            // Устанавливаем новую цель для плавного перехода
-            combFiltersR[i].targetDelayTime = newDelayTime;
+            auto& filter = filters[i];
+            float newDelayTime = derived.allPassDelays[channel][i];
             
-            // Вычисляем скорость изменения
-            float delayDifference = combFiltersR[i].targetDelayTime - combFiltersR[i].currentDelayTime;
-            combFiltersR[i].delayChangeRate = delayDifference * delayTransitionSpeed;
-    }
-    
-        // Убеждаемся что буфер достаточно большой для любого времени задержки
-        size_t maxPossibleDelayTime = static_cast<size_t>(newDelayTime * 1.2f); // 20% запас
-        size_t requiredBufferSize = maxPossibleDelayTime + blockSize;
-        
-        if (combFiltersR[i].buffer.size() < requiredBufferSize)
-        {
-            combFiltersR[i].buffer.resize(requiredBufferSize, 0.0f);
+            if (newDelayTime == filter.targetDelayTime)
+                continue;
+            
+            jassert(newDelayTime <= static_cast<float>(filter.line.getMaximumDelay()));
+            
+            // Инициализация fractional delay при первом использовании
+            if (filter.currentDelayTime == 0.0f)
+            {
+                filter.currentDelayTime = newDelayTime;
+                filter.targetDelayTime = newDelayTime;
+                continue;
+            }
+            
+            // Кроссфейд: идущий переход не прерывается, новая цель ждет его конца
+            if (delayTransition == DelayTransition::Crossfade)
+            {
+                filter.targetDelayTime = newDelayTime;
+                
+                if (filter.fadeStep == 0.0f && filter.currentDelayTime != newDelayTime)
+                {
+                    filter.fadeFromDelay = static_cast<int>(filter.currentDelayTime);
+                    filter.currentDelayTime = newDelayTime;
+                    filter.fadeProgress = 0.0f;
+                    filter.fadeStep = 1.0f / static_cast<float>(crossfadeSamples);
+                }
+                
+                continue;
+            }
+            
+            // Интерполятор Тирана стартует с текущего выхода линии
+            if (filter.currentDelayTime == filter.targetDelayTime)
+                filter.interpolatorState = filter.line.read(static_cast<int>(filter.currentDelayTime));
+            
+            // Устанавливаем новую цель и скорость плавного перехода
+            filter.targetDelayTime = newDelayTime;
+            filter.delayChangeRate = (filter.targetDelayTime - filter.currentDelayTime) * delayTransitionSpeed;
         }
     }
+}
+
+//==============================================================================
+// Обработка сигнала
+//==============================================================================
+
+void ReverbEngine::processAllPassFilter(const float* input, float* output, int numSamples, AllPassFilter& filter)
+{
+    // Задержка меняется только после applyDelayTimes() - в остальное время
+    // работает блочное векторное ядро (или целое чтение для очень коротких задержек)
+    float nearest = std::min(filter.currentDelayTime, filter.targetDelayTime);
+    float farthest = std::max(filter.currentDelayTime, filter.targetDelayTime);
     
-    // Обновляем allpass фильтры - левый канал
-    for (size_t i = 0; i < allPassFiltersL.size() && i < newAllPassDelaysL.size(); ++i)
+    if (filter.fadeStep > 0.0f)
     {
-        float newDelayTime = static_cast<float>(newAllPassDelaysL[i]);
-        
-        // Инициализация fractional delay при первом использовании
-        if (allPassFiltersL[i].currentDelayTime == 0.0f)
-        {
-            allPassFiltersL[i].currentDelayTime = newDelayTime;
-            allPassFiltersL[i].targetDelayTime = newDelayTime;
-        }
-        else
-        {
-            // Устанавливаем новую цель для плавного перехода
-            allPassFiltersL[i].targetDelayTime = newDelayTime;
-            
-            // Вычисляем скорость изменения
-            float delayDifference = allPassFiltersL[i].targetDelayTime - allPassFiltersL[i].currentDelayTime;
-            allPassFiltersL[i].delayChangeRate = delayDifference * delayTransitionSpeed;
-    }
-
-        // Убеждаемся что буфер достаточно большой для любого времени задержки
-        size_t maxPossibleDelayTime = static_cast<size_t>(newDelayTime * 1.2f); // 20% запас
-        size_t requiredBufferSize = maxPossibleDelayTime + blockSize;
-        
-        if (allPassFiltersL[i].buffer.size() < requiredBufferSize)
-        {
-            allPassFiltersL[i].buffer.resize(requiredBufferSize, 0.0f);
-        }
+        nearest = std::min(nearest, static_cast<float>(filter.fadeFromDelay));
+        farthest = std::max(farthest, static_cast<float>(filter.fadeFromDelay));
     }
     
-    // Обновляем allpass фильтры - правый канал
-    for (size_t i = 0; i < allPassFiltersR.size() && i < newAllPassDelaysR.size(); ++i)
+    filter.line.prepareBlock(nearest, farthest, numSamples);
+    
+    if (filter.fadeStep > 0.0f)
     {
-        float newDelayTime = static_cast<float>(newAllPassDelaysR[i]);
-        
-        // Инициализация fractional delay при первом использовании
-        if (allPassFiltersR[i].currentDelayTime == 0.0f)
-        {
-            allPassFiltersR[i].currentDelayTime = newDelayTime;
-            allPassFiltersR[i].targetDelayTime = newDelayTime;
-    }
-        else
-        {
-            // Устанавливаем новую цель для плавного перехода
-            allPassFiltersR[i].targetDelayTime = newDelayTime;
-            
-            // Вычисляем скорость изменения
-            float delayDifference = allPassFiltersR[i].targetDelayTime - allPassFiltersR[i].currentDelayTime;
-            allPassFiltersR[i].delayChangeRate = delayDifference * delayTransitionSpeed;
+        processAllPassFilterCrossfade(input, output, numSamples, filter);
     }
-
-        // Убеждаемся что буфер достаточно большой для любого времени задержки
-        size_t maxPossibleDelayTime = static_cast<size_t>(newDelayTime * 1.2f); // 20% запас
-        size_t requiredBufferSize = maxPossibleDelayTime + blockSize;
-        
-        if (allPassFiltersR[i].buffer.size() < requiredBufferSize)
+    else if (filter.currentDelayTime != filter.targetDelayTime)
     {
-            allPassFiltersR[i].buffer.resize(requiredBufferSize, 0.0f);
+        switch (interpolation)
+        {
+            case InterpolationMode::None:    processAllPassFilterKernel<true, InterpolationMode::None>(input, output, numSamples, filter); break;
+            case InterpolationMode::Linear:  processAllPassFilterKernel<true, InterpolationMode::Linear>(input, output, numSamples, filter); break;
+            case InterpolationMode::Hermite: processAllPassFilterKernel<true, InterpolationMode::Hermite>(input, output, numSamples, filter); break;
+            case InterpolationMode::Thiran:  processAllPassFilterKernel<true, InterpolationMode::Thiran>(input, output, numSamples, filter); break;
         }
     }
-    }
-
-//==============================================================================
-// Обработка сигнала
-//==============================================================================
+    else if (static_cast<int>(filter.currentDelayTime) >= DelayLine::minimumChunkLength)
+        processAllPassFilterChunked(input, output, numSamples, filter);
+    else
+        processAllPassFilterKernel<false>(input, output, numSamples, filter);
+}
 
-void ReverbEngine::processCombFilter(const float* input, float* output, int numSamples, CombFilter& filter)
+void ReverbEngine::processAllPassFilterChunked(const float* input, float* output, int numSamples, AllPassFilter& filter)
 {
-    if (filter.buffer.empty())
-        return;
+    using namespace SimdOps;
+    
+    const float g = filter.feedback;
+    const Vec feedbackVec = broadcast(g);
+    const Vec negFeedbackVec = broadcast(-g);
+    
+    // y[n] = -g*x[n] + d[n] + g*d[n], v[n] = x[n] + g*d[n], где d[n] = v[n-M]:
+    // на участке длиной <= M все d[n] уже в линии, цикл по времени векторизуется.
+    // Векторная часть округляет так же, как скалярный хвост, - результат не
+    // зависит от того, где проходят границы участков и блоков
+    filter.line.processInChunks(static_cast<int>(filter.currentDelayTime), numSamples,
+        [&] (const float* delayedSamples, float* writeSamples, int offset, int count)
+        {
+            const float* x = input + offset;
+            float* y = output + offset;
+            int i = 0;
+            
+            for (; i + width <= count; i += width)
+            {
+                const Vec in = loadUnaligned(x + i);
+                const Vec delayed = loadUnaligned(delayedSamples + i);
+                storeUnaligned(writeSamples + i, add(in, mul(feedbackVec, delayed)));
+                storeUnaligned(y + i, add(add(mul(negFeedbackVec, in), delayed), mul(feedbackVec, delayed)));
+            }
+            
+            for (; i < count; ++i)
+            {
+                const float delayed = delayedSamples[i];
+                writeSamples[i] = x[i] + g * delayed;
+                y[i] = -g * x[i] + delayed + g * delayed;
+            }
+        });
+}
 
-    const size_t bufferSize = filter.buffer.size();
+void ReverbEngine::processAllPassFilterCrossfade(const float* input, float* output, int numSamples, AllPassFilter& filter)
+{
+    const float g = filter.feedback;
     
     for (int i = 0; i < numSamples; ++i)
     {
-        // FRACTIONAL DELAY: Плавное изменение времени задержки
-        if (std::abs(filter.currentDelayTime - filter.targetDelayTime) > 0.1f)
-        {
-            filter.currentDelayTime += filter.delayChangeRate;
-            
-            // Защита от переполнения
-            if (filter.delayChangeRate > 0 && filter.currentDelayTime > filter.targetDelayTime)
-                filter.currentDelayTime = filter.targetDelayTime;
-            else if (filter.delayChangeRate < 0 && filter.currentDelayTime < filter.targetDelayTime)
-                filter.currentDelayTime = filter.targetDelayTime;
-        }
-        
-        // Читаем задержанный сигнал с интерполяцией
-        float fractionalDelay = filter.currentDelayTime;
-        float delayedSample = readWithInterpolation(filter.buffer, filter.writeIndex, fractionalDelay, bufferSize);
+        // Два целых отвода с кроссфейдом; после его конца - один отвод
+        float delayedSample = filter.line.read(static_cast<int>(filter.currentDelayTime));
         
-        // ПРАВИЛЬНАЯ COMB FORMULA: y[n] = x[n] + g*y[n-M]
-        float combOutput = input[i] + filter.feedback * delayedSample;
-        
-        // Применяем damping для высокочастотного затухания
-        if (filter.damping > 0.0f)
+        if (filter.fadeStep > 0.0f)
         {
-            combOutput *= (1.0f - filter.damping);
+            float fadeOut, fadeIn;
+            DelayLine::crossfadeGains(filter.fadeProgress, fadeOut, fadeIn);
+            delayedSample = fadeOut * filter.line.read(filter.fadeFromDelay) + fadeIn * delayedSample;
+            
+            filter.fadeProgress += filter.fadeStep;
+            
+            if (filter.fadeProgress >= 1.0f)
+            {
+                filter.fadeProgress = 0.0f;
+                
+                // Отложенная цель - следующий кроссфейд той же длины
+                if (filter.targetDelayTime != filter.currentDelayTime)
+                {
+                    filter.fadeFromDelay = static_cast<int>(filter.currentDelayTime);
+                    filter.currentDelayTime = filter.targetDelayTime;
+                }
+                else
+                {
+                    filter.fadeStep = 0.0f;
+                }
+            }
         }
         
-        // Записываем в буфер
-        filter.buffer[filter.writeIndex] = combOutput;
-        
-        // Выходной сигнал (убрали crossfade - теперь плавность обеспечивает fractional delay)
-        output[i] = combOutput;
-        
-        // Обновляем write index
-        filter.writeIndex = (filter.writeIndex + 1) % bufferSize;
+        output[i] = -g * input[i] + delayedSample + g * delayedSample;
+        filter.line.push(input[i] + g * delayedSample);
     }
 }
 
-void ReverbEngine::processAllPassFilter(const float* input, float* output, int numSamples, AllPassFilter& filter)
+template <bool Gliding, InterpolationMode Mode>
+void ReverbEngine::processAllPassFilterKernel(const float* input, float* output, int numSamples, AllPassFilter& filter)
 {
-    if (filter.buffer.empty())
-        return;
-
-    const size_t bufferSize = filter.buffer.size();
+    const int integerDelay = static_cast<int>(filter.currentDelayTime);
     
     for (int i = 0; i < numSamples; ++i)
     {
-        // FRACTIONAL DELAY: Плавное изменение времени задержки
-        if (std::abs(filter.currentDelayTime - filter.targetDelayTime) > 0.1f)
+        float delayedSample;
+        
+        if constexpr (Gliding)
         {
-            filter.currentDelayTime += filter.delayChangeRate;
+            // FRACTIONAL DELAY: Плавное изменение времени задержки
+            if (filter.currentDelayTime != filter.targetDelayTime)
+                filter.currentDelayTime = DelayLine::stepDelayGlide(filter.currentDelayTime, filter.targetDelayTime,
+                                                                    filter.delayChangeRate);
             
-            // Защита от переполнения
-            if (filter.delayChangeRate > 0 && filter.currentDelayTime > filter.targetDelayTime)
-                filter.currentDelayTime = filter.targetDelayTime;
-            else if (filter.delayChangeRate < 0 && filter.currentDelayTime < filter.targetDelayTime)
-                filter.currentDelayTime = filter.targetDelayTime;
+            // Читаем задержанный сигнал с интерполяцией выбранного качества
+            delayedSample = filter.line.readInterpolated<Mode>(filter.currentDelayTime, filter.interpolatorState);
+        }
+        else
+        {
+            delayedSample = filter.line.read(integerDelay);
         }
-        
-        // Читаем задержанный сигнал с интерполяцией
-        float fractionalDelay = filter.currentDelayTime;
-        float delayedSample = readWithInterpolation(filter.buffer, filter.writeIndex, fractionalDelay, bufferSize);
         
         // ПРАВИЛЬНАЯ ALL-PASS FORMULA: y[n] = -g*x[n] + x[n-M] + g*y[n-M]
         float allPassOutput = -filter.feedback * input[i] + delayedSample + filter.feedback * delayedSample;
         
-        // Записываем в буфер
-        filter.buffer[filter.writeIndex] = input[i] + filter.feedback * delayedSample;
+        // Записываем в буфер (индекс записи сдвигается внутри линии)
+        filter.line.push(input[i] + filter.feedback * delayedSample);
         
         // Выходной сигнал (убрали crossfade - теперь плавность обеспечивает fractional delay)
         output[i] = allPassOutput;
-        
-        // Обновляем write index
-        filter.writeIndex = (filter.writeIndex + 1) % bufferSize;
-    }
-}
-
-void ReverbEngine::processEarlyReflections(const float* input, float* output, int numSamples,
-                                         std::vector<EarlyReflection>& reflections)
-{
-    // Обнуляем выходной буфер
-    std::fill(output, output + numSamples, 0.0f);
-    
-    // Обрабатываем каждое отражение
-    for (auto& reflection : reflections)
-    {
-        for (int i = 0; i < numSamples; ++i)
-        {
-            // Записываем новый сэмпл в буфер
-            reflection.buffer[reflection.writeIndex] = input[i];
-            
-            // Читаем задержанный сэмпл
-            float delayedSample = reflection.buffer[reflection.readIndex];
-            
-            // Добавляем к выходу с учетом gain
-            output[i] += delayedSample * reflection.gain;
-            
-            // Обновляем индексы с учетом размера буфера
-            reflection.readIndex = (reflection.readIndex + 1) % reflection.buffer.size();
-            reflection.writeIndex = (reflection.writeIndex + 1) % reflection.buffer.size();
-        }
     }
 }
 
@@ -1099,66 +1286,3 @@ float ReverbEngine::calculateReverbTime()
 {
     return MathUtils::calculateReverbTime(params.roomSize, params.damping);
 }
-
-void ReverbEngine::updateStereoMixing()
-{
-    // Freeverb-style стерео микширование с исправленными коэффициентами
-    float effectMix = params.dryWetMix / 100.0f;  // 0-1
-    float width = params.stereoWidth / 100.0f;    // 0-1.5
-    
-    // ИСПРАВЛЕНО: Уменьшенные коэффициенты для предотвращения перегруза
-    const float scaleWet = 1.0f;  // Было 3.0f - слишком много!
-    const float scaleDry = 1.0f;  // Было 2.0f - слишком много!
-    
-    float wet1_calc = scaleWet * effectMix;
-    float dry1_calc = scaleDry * (1.0f - effectMix);
-    
-    float wet_total = wet1_calc / (wet1_calc + dry1_calc);
-    float dry_total = dry1_calc / (wet1_calc + dry1_calc);
-    
-    // Стерео ширина влияет на cross-mixing
-    wet1 = wet_total * (width / 2.0f + 0.5f);
-    wet2 = wet_total * (1.0f - width) / 2.0f;
-    dry = dry_total;
-    
-    // ИСПРАВЛЕНО: Более строгие ограничения + общая нормализация
-    wet1 = MathUtils::clamp(wet1, 0.0f, 1.0f);
-    wet2 = MathUtils::clamp(wet2, 0.0f, 1.0f);
-    dry = MathUtils::clamp(dry, 0.0f, 1.0f);
-    
-    // Общая нормализация для предотвращения перегруза
-    float totalGain = wet1 + wet2 + dry;
-    if (totalGain > 1.0f)
-    {
-        wet1 /= totalGain;
-        wet2 /= totalGain;
-        dry /= totalGain;
-    }
-}
-
-// Вспомогательная функция для чтения с интерполяцией (fractional delay)
-float ReverbEngine::readWithInterpolation(const std::vector<float>& buffer, size_t writeIndex, float fractionalDelay, size_t bufferSize)
-{
-    if (buffer.empty() || fractionalDelay <= 0.0f)
-        return 0.0f;
-        
-    // Вычисляем позицию чтения (назад от writeIndex)
-    float readPosition = static_cast<float>(writeIndex) - fractionalDelay;
-    
-    // Обрабатываем wrap-around
-    while (readPosition < 0)
-        readPosition += static_cast<float>(bufferSize);
-    while (readPosition >= static_cast<float>(bufferSize))
-        readPosition -= static_cast<float>(bufferSize);
-        
-    // Получаем целую и дробную части
-    int readIndex1 = static_cast<int>(readPosition);
-    int readIndex2 = (readIndex1 + 1) % bufferSize;
-    float fraction = readPosition - static_cast<float>(readIndex1);
-    
-    // Линейная интерполяция между двумя соседними сэмплами
-    float sample1 = buffer[readIndex1];
-    float sample2 = buffer[readIndex2];
-    
-    return sample1 + fraction * (sample2 - sample1);
-} 
\ No newline at end of file
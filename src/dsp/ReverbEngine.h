@@ -1,9 +1,17 @@
 #pragma once
 
 #include <juce_audio_processors/juce_audio_processors.h>
+#include <array>
 #include <vector>
 #include <memory>
 #include "utils/Logger.h"
+#include "ScratchArena.h"
+#include "CombBank.h"
+#include "DelayLine.h"
+#include "DelayLineArena.h"
+#include "MultiTapDelay.h"
+#include "TripleBuffer.h"
+#include "ReverbTopology.h"
 
 /**
  * @brief ReverbEngine на основе Schroeder/FDN с настоящим стерео
@@ -11,9 +19,16 @@
  * Основано на классических работах Schroeder (1961) и Moorer (1979)
  * Реализует настоящий стерео реверб как в Freeverb:
  * - 6 параллельных comb фильтров для каждого канала с разными задержками
+ *   (считаются одним векторным проходом в CombBank)
  * - 2 последовательных all-pass фильтра для каждого канала
  * - stereoSpread для декорреляции между каналами
  * - Cross-mixing для стерео ширины
+ *
+ * Потоки: сеттеры параметров только пересчитывают производные коэффициенты
+ * и публикуют их снимком через TripleBuffer. Сеттеры вызываются из одного
+ * потока вне аудио (TripleBuffer - один производитель). Аудио-поток забирает
+ * последний снимок в начале блока и применяет его к фильтрам - состояние
+ * фильтров меняет только аудио-поток.
  */
 class ReverbEngine
 {
@@ -23,7 +38,8 @@ public:
     ~ReverbEngine();
 
     //==============================================================================
-    // Основная обработка
+    // Основная обработка. process() - настоящий моно путь: один канал сети.
+    // processStereo() с одним и тем же буфером на L и R пропускает даунмикс.
     void process(const float* input, float* output, int numSamples);
     void processStereo(const float* inputL, const float* inputR, 
                       float* outputL, float* outputR, int numSamples);
@@ -33,6 +49,12 @@ public:
     void prepare(double sampleRate, int blockSize);
     void reset();
 
+    //==============================================================================
+    // Сон сети: после затухания хвоста при тихом входе comb/all-pass фильтры
+    // не считаются, на выход идет только dry. Первый не тихий блок будит сеть.
+    bool isSleeping() const { return sleeping; }
+    float getTailEnergy() const { return tailEnergy; }
+
     //==============================================================================
     // Параметры
     struct Parameters
@@ -43,9 +65,12 @@ public:
         float preDelay = 0.0f;         // ms, 0-500
         float stereoWidth = 100.0f;    // %, 0-150
         float dryWetMix = 50.0f;       // %, 0-100 (0=dry, 100=wet)
-        int numCombFilters = 6;        // Фиксированное количество по Schroeder
-        int numAllPassFilters = 2;     // Фиксированное количество по Schroeder
+        int numCombFilters = 6;        // Comb фильтров на канал, 2-16 (6 по Schroeder)
+        int numAllPassFilters = 2;     // All-pass фильтров на канал, 0-8 (2 по Schroeder)
         int stereoSpread = 23;         // Разница в задержках между каналами (сэмплы)
+        InterpolationMode interpolation = InterpolationMode::Linear; // Качество дробных задержек
+        DelayTransition delayTransition = DelayTransition::Glide;    // Переход при смене roomSize
+        float crossfadeTime = 50.0f;   // ms, 5-500 - длина кроссфейда (DelayTransition::Crossfade)
     };
 
     void setParameters(const Parameters& newParams);
@@ -59,70 +84,83 @@ public:
     void setPreDelay(float preDelayMs);
     void setStereoWidth(float widthPercent);
     void setDryWetMix(float mixPercent);
+    void setInterpolationMode(InterpolationMode newMode);
+    
+    // Переход задержек при смене roomSize: glide или кроссфейд двух отводов.
+    // Смена способа завершает идущие переходы мгновенно
+    void setDelayTransition(DelayTransition newTransition);
+    void setCrossfadeTime(float crossfadeMs);
+    
+    // Топология сети: память выделена в prepare() под максимум, поэтому
+    // смена числа фильтров на ходу не выделяет память
+    void setNumCombFilters(int numCombs);
+    void setNumAllPassFilters(int numAllPasses);
+    
+    // Готовые топологии (ReverbTopologies::compact/classic/dense) считаются
+    // ядрами с числом фильтров времени компиляции
+    void setTopology(const ReverbTopology& topology);
+    ReverbTopology getTopology() const { return { params.numCombFilters, params.numAllPassFilters }; }
+    
+    static constexpr int minCombFilters = 2;
+    static constexpr int maxCombFilters = CombBank::maxCombsPerChannel;
+    static constexpr int maxAllPassFilters = 8;
+    
+    static constexpr float minCrossfadeMs = 5.0f;
+    static constexpr float maxCrossfadeMs = 500.0f;
 
 private:
     //==============================================================================
-    // Comb Filter
-    struct CombFilter
+    // All-Pass Filter: только горячее посэмпловое состояние - одна кэш-линия.
+    // Память линии лежит в delayMemory, настройки приходят снимком параметров
+    struct alignas(64) AllPassFilter
     {
-        std::vector<float> buffer;
-        size_t readIndex = 0;
-        size_t writeIndex = 0;
-        size_t delayTime = 0;
+        DelayLine line;                  // Участок арены, маска и позиция записи
         float feedback = 0.0f;
-        float damping = 0.0f;
-        
-        // ПЛАВНЫЙ CROSSFADE для устранения щелчков при изменении параметров
-        float outputGain = 1.0f;        // Текущий gain выхода
-        float targetOutputGain = 1.0f;  // Целевой gain
-        int fadeRemaining = 0;          // Оставшиеся сэмплы fade
-        
-        // Новые параметры для применения после fade-out
-        bool pendingParameterChange = false;
-        size_t newDelayTime = 0;
-        size_t newBufferSize = 0;
         
         // FRACTIONAL DELAY для плавного изменения времени задержки
         float currentDelayTime = 0.0f;   // Текущее время задержки (может быть дробным)
         float targetDelayTime = 0.0f;    // Целевое время задержки
         float delayChangeRate = 0.0f;    // Скорость изменения задержки (сэмплов/сэмпл)
+        float interpolatorState = 0.0f;  // Состояние интерполятора Тирана
+        
+        // Кроссфейд двух целых отводов: currentDelayTime - новый отвод
+        float fadeProgress = 0.0f;       // 0..1
+        float fadeStep = 0.0f;           // 0 - кроссфейда нет
+        int fadeFromDelay = 0;           // Старый отвод
     };
+    
+    static_assert(sizeof(AllPassFilter) == 64, "AllPassFilter должен занимать одну кэш-линию");
+    
+    // Цепочка канала: фиксированный массив, активны первые numActiveAllPassFilters
+    using AllPassChain = std::array<AllPassFilter, maxAllPassFilters>;
 
     //==============================================================================
-    // All-Pass Filter
-    struct AllPassFilter
+    // Снимок производных коэффициентов: считается вне аудио-потока
+    static constexpr int numEarlyReflections = 8;
+    static_assert(ReverbTopologies::earlyReflectionRatios.size() == numEarlyReflections,
+                  "Таблица ранних отражений должна совпадать с числом отводов");
+
+    struct DerivedParameters
     {
-        std::vector<float> buffer;
-        size_t readIndex = 0;
-        size_t writeIndex = 0;
-        size_t delayTime = 0;
-        float feedback = 0.0f;
+        std::array<std::array<float, CombBank::maxCombsPerChannel>, 2> combDelays {};   // Сэмплы
+        std::array<std::array<float, maxAllPassFilters>, 2> allPassDelays {};          // Сэмплы
+        std::array<std::array<MultiTapDelay::Tap, numEarlyReflections>, 2> reflections {};
         
-        // ПЛАВНЫЙ CROSSFADE для устранения щелчков при изменении параметров
-        float outputGain = 1.0f;        // Текущий gain выхода
-        float targetOutputGain = 1.0f;  // Целевой gain
-        int fadeRemaining = 0;          // Оставшиеся сэмплы fade
+        int numCombFilters = 6;
+        int numAllPassFilters = 2;
         
-        // Новые параметры для применения после fade-out
-        bool pendingParameterChange = false;
-        size_t newDelayTime = 0;
-        size_t newBufferSize = 0;
+        float combFeedback = 0.0f;
+        float combDamping = 0.0f;
+        float allPassFeedback = 0.5f;
+        InterpolationMode interpolation = InterpolationMode::Linear;
+        DelayTransition delayTransition = DelayTransition::Glide;
+        int crossfadeSamples = 1;
         
-        // FRACTIONAL DELAY для плавного изменения времени задержки
-        float currentDelayTime = 0.0f;   // Текущее время задержки (может быть дробным)
-        float targetDelayTime = 0.0f;    // Целевое время задержки
-        float delayChangeRate = 0.0f;    // Скорость изменения задержки (сэмплов/сэмпл)
-    };
-
-    //==============================================================================
-    // Early Reflections
-    struct EarlyReflection
-    {
-        std::vector<float> buffer;
-        size_t readIndex = 0;
-        size_t writeIndex = 0;
-        size_t delayTime = 0;
-        float gain = 1.0f;
+        int preDelaySamples = 0;
+        
+        float wet1 = 1.0f;
+        float wet2 = 0.0f;
+        float dry = 0.0f;
     };
 
     //==============================================================================
@@ -132,65 +170,103 @@ private:
     int blockSize = 512;
     bool isPrepared = false;
 
+    // Диапазон roomSize: память линий выделяется в prepare() под максимум
+    static constexpr float minRoomSize = 10.0f;
+    static constexpr float maxRoomSize = 10000.0f;
+
+    // Память всех линий задержки движка: один выровненный блок
+    DelayLineArena delayMemory;
+    
     // Компоненты реверберации - СТЕРЕО
-    std::vector<CombFilter> combFiltersL;      // Левый канал
-    std::vector<CombFilter> combFiltersR;      // Правый канал
-    std::vector<AllPassFilter> allPassFiltersL; // Левый канал
-    std::vector<AllPassFilter> allPassFiltersR; // Правый канал
-    std::vector<EarlyReflection> earlyReflectionsL; // Левый канал
-    std::vector<EarlyReflection> earlyReflectionsR; // Правый канал
-    
-    // Pre-delay - стерео
-    std::vector<float> preDelayBufferL;
-    std::vector<float> preDelayBufferR;
-    size_t preDelayIndexL = 0;
-    size_t preDelayIndexR = 0;
+    CombBank combBank;                          // Comb фильтры обоих каналов (SoA)
+    AllPassChain allPassFiltersL;               // Левый канал
+    AllPassChain allPassFiltersR;               // Правый канал
+    int numActiveAllPassFilters = 0;            // Первые N фильтров цепочки (аудио-поток)
+    MultiTapDelay earlyReflections;             // Одна линия, отводы L и R
+    static constexpr float maxEarlyReflectionMs = 45.0f;
+    
+    // Pre-delay на моно-входе реверба, память выделяется в prepare() под максимум
+    static constexpr float maxPreDelayMs = 500.0f;
+    DelayLine preDelayLine;
     int preDelaySamples = 0;
+    bool preDelayWasBypassed = true;
     
-    // Временные буферы - стерео
-    std::vector<float> tempBufferL;
-    std::vector<float> tempBufferR;
-    std::vector<float> combOutputL;
-    std::vector<float> combOutputR;
-    std::vector<float> allPassOutputL;
-    std::vector<float> allPassOutputR;
-    std::vector<float> earlyReflectionsBufferL;
-    std::vector<float> earlyReflectionsBufferR;
+    // Детектор тишины и сон сети
+    static constexpr float silenceThreshold = 1.0e-5f;     // Пик входа, -100 dB
+    static constexpr float tailEnergyThreshold = 1.0e-10f; // Средний квадрат хвоста, -100 dB
+    bool sleeping = false;
+    float tailEnergy = 0.0f;
+    int quietSamples = 0;
+    
+    // Временные буферы - выдаются из арены, размер задается в prepare()
+    static constexpr int numScratchBuffers = 8;
+    ScratchArena scratch;
     
     // Параметры микширования для стерео
     float wet1 = 1.0f;  // Основной wet gain
     float wet2 = 0.0f;  // Cross-channel wet gain
     float dry = 0.0f;   // Dry gain
+    
+    // Качество интерполяции и переход задержек (состояние аудио-потока)
+    InterpolationMode interpolation = InterpolationMode::Linear;
+    DelayTransition delayTransition = DelayTransition::Glide;
+    int crossfadeSamples = 1;
+    
+    // Передача снимков параметров: сеттеры -> аудио-поток
+    TripleBuffer<DerivedParameters> parameterSnapshots;
+    
+    // До первого изменения параметров фильтров действует начальный damping
+    // из initializeCombFilters() (без масштаба 5%)
+    bool useInitialDamping = true;
 
     //==============================================================================
     // Внутренние методы
     void initializeCombFilters();
     void initializeAllPassFilters();
     void initializeEarlyReflections();
-    void updateFilterParameters();
-    void updatePreDelay();
-    void updateEarlyReflections();
-    void updateStereoMixing();
+    void initializePreDelay();
     
-    // НОВЫЕ МЕТОДЫ: Обновление времен задержек без переинициализации буферов
-    void updateDelayTimes();
-    void updateEarlyReflectionDelayTimes();
+    // Расчет снимка (поток сеттеров) - фильтры не трогает
+    void publishParameters();
+    void computeFilterParameters(DerivedParameters& derived) const;
+    void computeDelayTimes(DerivedParameters& derived) const;
+    void computeEarlyReflections(DerivedParameters& derived) const;
+    void computePreDelay(DerivedParameters& derived) const;
+    void computeStereoMixing(DerivedParameters& derived) const;
     
-    // Масштабируемые времена задержек - для стерео
-    std::vector<int> getScaledCombDelays(bool isRightChannel = false);
-    std::vector<int> getScaledAllPassDelays(bool isRightChannel = false);
-    std::vector<float> getEarlyReflectionDelays(bool isRightChannel = false);
+    // Применение снимка (аудио-поток, начало блока)
+    void pullParameters();
+    void applyParameters(const DerivedParameters& derived);
+    void applyTopology(const DerivedParameters& derived);
+    void applyDelayTimes(const DerivedParameters& derived);
+    
+    // Масштабируемые времена задержек - для стерео. Задержки растут вместе
+    // с roomSize, поэтому худший случай для выделения памяти - maxRoomSize
+    ReverbTopologies::DelayTable getScaledCombDelays(float roomSize, int numCombs, bool isRightChannel = false) const;
+    ReverbTopologies::DelayTable getScaledAllPassDelays(float roomSize, int numAllPasses, bool isRightChannel = false) const;
+    int getLongestCombDelay(bool isRightChannel) const;
+    int getLongestAllPassDelay(bool isRightChannel) const;
+    std::array<float, numEarlyReflections> getEarlyReflectionDelays(bool isRightChannel = false) const;
     
     // Математические утилиты
-    static bool areMutuallyPrime(const std::vector<int>& delays);
-    static int gcd(int a, int b);
     static float calculateFeedback(float decayTime, double sampleRate);
     static float calculateRoomScale(float roomSize);
 
-    void processCombFilter(const float* input, float* output, int numSamples, CombFilter& filter);
     void processAllPassFilter(const float* input, float* output, int numSamples, AllPassFilter& filter);
-    void processEarlyReflections(const float* input, float* output, int numSamples, 
-                                std::vector<EarlyReflection>& reflections);
+    template <bool Gliding, InterpolationMode Mode = InterpolationMode::Linear>
+    void processAllPassFilterKernel(const float* input, float* output, int numSamples, AllPassFilter& filter);
+    void processAllPassFilterChunked(const float* input, float* output, int numSamples, AllPassFilter& filter);
+    void processAllPassFilterCrossfade(const float* input, float* output, int numSamples, AllPassFilter& filter);
+    static bool isBlockSilent(const float* inputL, const float* inputR, int numSamples);
+    void updateSleepState(bool inputSilent, const float* reverbL, const float* reverbR, int numSamples);
+    int getTailWindowSamples() const;
+    const float* processPreDelay(const float* input, float* delayBuffer, int numSamples);
+    void processMonoBlock(const float* input, float* output, int numSamples);
+    void processStereoBlock(const float* inputL, const float* inputR,
+                            float* outputL, float* outputR, int numSamples);
+    void processAllPassChain(float* buffer, int numSamples, AllPassChain& allPassFilters);
+    template <int FixedAllPasses>
+    void processAllPassChainKernel(float* buffer, int numSamples, AllPassChain& allPassFilters);
 
     float calculateReverbTime();
 
@@ -201,9 +277,6 @@ private:
     // Логирование состояния реверберации
     void logReverbState() const;
 
-    // Вспомогательные функции для fractional delay
-    float readWithInterpolation(const std::vector<float>& buffer, size_t writeIndex, float fractionalDelay, size_t bufferSize);
-
     // JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ReverbEngine)
 }; 
\ No newline at end of file
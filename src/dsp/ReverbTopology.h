@@ -0,0 +1,156 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+/**
+ * @brief Топология сети Schroeder: число comb и all-pass фильтров на канал
+ *
+ * Для нескольких типовых топологий (compact 4/1, classic 6/2, dense 8/4)
+ * CombBank и цепочка all-pass фильтров ReverbEngine используют ядра, где
+ * число фильтров и каналов - параметры шаблона: циклы по дорожкам имеют
+ * известную длину и разворачиваются компилятором. Остальные сочетания
+ * считаются общим ядром с числом фильтров во время выполнения.
+ */
+struct ReverbTopology
+{
+    int numCombs = 6;
+    int numAllPasses = 2;
+};
+
+/**
+ * @brief Специализированные топологии и таблицы задержек времени компиляции
+ *
+ * Базовые таблицы задержек (мс) - constexpr std::array. Растяжение таблицы
+ * на нужное число фильтров, перевод в сэмплы и сдвиг к попарно взаимно
+ * простым задержкам - constexpr функции без кучи: их вызывают сеттеры
+ * ReverbEngine, а static_assert ниже проверяет генерацию на опорной
+ * настройке (44.1 кГц, средняя комната) для каждой специализированной
+ * топологии. Взаимная простота нужна именно в сэмплах, поэтому для
+ * текущих sampleRate и roomSize она восстанавливается той же функцией.
+ */
+namespace ReverbTopologies
+{
+    //==============================================================================
+    constexpr ReverbTopology compact { 4, 1 };
+    constexpr ReverbTopology classic { 6, 2 };
+    constexpr ReverbTopology dense   { 8, 4 };
+
+    constexpr int maxDelaysPerTable = 16;
+
+    using DelayTable = std::array<int, maxDelaysPerTable>;
+
+    //==============================================================================
+    // Базовые времена задержек, мс
+    constexpr std::array<float, 6> smallRoomCombMs  { 10.0f, 12.0f, 15.0f, 18.0f, 21.0f, 24.0f };  // Быстрые, плотные отражения
+    constexpr std::array<float, 6> mediumRoomCombMs { 29.7f, 37.1f, 41.1f, 43.7f, 50.0f, 56.0f };  // Классические времена Schroeder
+    constexpr std::array<float, 6> largeRoomCombMs  { 70.0f, 83.0f, 97.0f, 111.0f, 127.0f, 142.0f }; // Медленные, разреженные отражения
+    constexpr std::array<float, 2> allPassMs        { 2.0f, 4.0f };                                 // Ниже порога восприятия delay (5 мс)
+
+    // Ранние отражения: множители базовой задержки (3-15 мс по roomSize) -
+    // плотная структура с малыми промежутками между отражениями
+    constexpr std::array<float, 8> earlyReflectionRatios { 1.0f, 1.15f, 1.35f, 1.58f, 1.84f, 2.12f, 2.43f, 2.77f };
+
+    //==============================================================================
+    constexpr int gcd(int a, int b)
+    {
+        while (b != 0)
+        {
+            const int temp = b;
+            b = a % b;
+            a = temp;
+        }
+
+        return a;
+    }
+
+    template <std::size_t N>
+    constexpr bool areMutuallyPrime(const std::array<int, N>& delays, int count)
+    {
+        for (int i = 0; i < count; ++i)
+            for (int j = i + 1; j < count; ++j)
+                if (gcd(delays[static_cast<std::size_t>(i)], delays[static_cast<std::size_t>(j)]) != 1)
+                    return false;
+
+        return true;
+    }
+
+    // Каждая задержка сдвигается вверх до ближайшего значения, взаимно
+    // простого со всеми предыдущими (сдвиг - единицы сэмплов)
+    template <std::size_t N>
+    constexpr void makeMutuallyPrime(std::array<int, N>& delays, int count)
+    {
+        for (int i = 1; i < count; ++i)
+        {
+            bool sharesFactor = true;
+
+            while (sharesFactor)
+            {
+                sharesFactor = false;
+
+                for (int j = 0; j < i && ! sharesFactor; ++j)
+                    sharesFactor = gcd(delays[static_cast<std::size_t>(i)], delays[static_cast<std::size_t>(j)]) != 1;
+
+                if (sharesFactor)
+                    ++delays[static_cast<std::size_t>(i)];
+            }
+        }
+    }
+
+    //==============================================================================
+    // count точек с линейной интерполяцией по индексу таблицы:
+    // при count == N возвращается сама таблица
+    template <std::size_t N>
+    constexpr std::array<float, maxDelaysPerTable> spreadTable(const std::array<float, N>& table, int count)
+    {
+        std::array<float, maxDelaysPerTable> spread {};
+
+        if (count == 1)
+            spread[0] = table[0];
+
+        if (count <= 1)
+            return spread;
+
+        const float lastIndex = static_cast<float>(N - 1);
+
+        for (int i = 0; i < count && i < maxDelaysPerTable; ++i)
+        {
+            const float position = lastIndex * static_cast<float>(i) / static_cast<float>(count - 1);
+            const std::size_t index = static_cast<std::size_t>(position) < N - 1 ? static_cast<std::size_t>(position) : N - 1;
+            const std::size_t next = index + 1 < N ? index + 1 : N - 1;
+            const float fraction = position - static_cast<float>(index);
+
+            spread[static_cast<std::size_t>(i)] = table[index] + fraction * (table[next] - table[index]);
+        }
+
+        return spread;
+    }
+
+    // Растянутая таблица в сэмплах со сдвигом offset (stereoSpread) и
+    // нижней границей minimum, затем - к попарно взаимно простым задержкам
+    template <std::size_t N>
+    constexpr DelayTable makeDelayTable(const std::array<float, N>& tableMs, int count, float roomScale,
+                                        double sampleRate, int offset, int minimum)
+    {
+        const auto spread = spreadTable(tableMs, count);
+        DelayTable delays {};
+
+        for (int i = 0; i < count && i < maxDelaysPerTable; ++i)
+        {
+            const float scaledDelayMs = spread[static_cast<std::size_t>(i)] * roomScale;
+            const int samples = static_cast<int>((scaledDelayMs / 1000.0f) * sampleRate) + offset;
+            delays[static_cast<std::size_t>(i)] = samples > minimum ? samples : minimum;
+        }
+
+        makeMutuallyPrime(delays, count);
+        return delays;
+    }
+
+    //==============================================================================
+    // Проверка генерации на опорной настройке: 44.1 кГц, 1000 м² (roomScale = 1)
+    static_assert(areMutuallyPrime(makeDelayTable(mediumRoomCombMs, compact.numCombs, 1.0f, 44100.0, 0, 1), compact.numCombs), "");
+    static_assert(areMutuallyPrime(makeDelayTable(mediumRoomCombMs, classic.numCombs, 1.0f, 44100.0, 0, 1), classic.numCombs), "");
+    static_assert(areMutuallyPrime(makeDelayTable(mediumRoomCombMs, dense.numCombs, 1.0f, 44100.0, 0, 1), dense.numCombs), "");
+    static_assert(areMutuallyPrime(makeDelayTable(allPassMs, dense.numAllPasses, 1.0f, 44100.0, 0, 1), dense.numAllPasses), "");
+    static_assert(makeDelayTable(mediumRoomCombMs, classic.numCombs, 1.0f, 44100.0, 0, 1)[0] == 1309, "");
+}
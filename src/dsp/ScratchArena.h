@@ -0,0 +1,95 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include "AlignedBuffer.h"
+
+/**
+ * @brief Арена временной памяти для аудио-потока
+ *
+ * Вся память выделяется один раз в prepare(). Во время обработки блока
+ * промежуточные буферы выдаются из непрерывного участка простым сдвигом
+ * указателя и возвращаются все разом через ScopedFrame, поэтому
+ * на аудио-потоке нет ни одной аллокации в куче.
+ */
+class ScratchArena
+{
+public:
+    //==============================================================================
+    ScratchArena() = default;
+    ~ScratchArena() = default;
+
+    //==============================================================================
+    // Подготовка (вызывается вне аудио-потока)
+    void prepare(int numBuffers, int maxSamples)
+    {
+        this->maxSamples = maxSamples;
+
+        // Каждый буфер выравнивается по 64 байта (кэш-линия / AVX-512)
+        bufferStride = AlignedBuffer::roundUpToAlignment(static_cast<size_t>(maxSamples));
+        capacity = bufferStride * static_cast<size_t>(numBuffers);
+
+        // Повторный prepare() с тем же или меньшим размером не выделяет память
+        storage.ensureSize(capacity);
+        base = storage.get();
+
+        used = 0;
+    }
+
+    void reset() { used = 0; }
+
+    //==============================================================================
+    // Выдача буфера на время текущего блока
+    float* allocate(int numSamples)
+    {
+        const size_t size = AlignedBuffer::roundUpToAlignment(static_cast<size_t>(numSamples));
+
+        if (base == nullptr || used + size > capacity)
+        {
+            jassertfalse; // Арена подготовлена под меньший блок или меньшее число буферов
+            return nullptr;
+        }
+
+        float* buffer = base + used;
+        used += size;
+        return buffer;
+    }
+
+    float* allocateCleared(int numSamples)
+    {
+        float* buffer = allocate(numSamples);
+        if (buffer != nullptr)
+            std::fill(buffer, buffer + numSamples, 0.0f);
+        return buffer;
+    }
+
+    int getMaxSamples() const { return maxSamples; }
+
+    //==============================================================================
+    /**
+     * @brief RAII-кадр: все буферы, выданные внутри кадра, освобождаются при выходе
+     */
+    class ScopedFrame
+    {
+    public:
+        explicit ScopedFrame(ScratchArena& arenaToUse)
+            : arena(arenaToUse), mark(arenaToUse.used) {}
+        ~ScopedFrame() { arena.used = mark; }
+
+    private:
+        ScratchArena& arena;
+        size_t mark;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedFrame)
+    };
+
+private:
+    //==============================================================================
+    AlignedBuffer storage;
+    float* base = nullptr;
+    size_t capacity = 0;
+    size_t bufferStride = 0;
+    size_t used = 0;
+    int maxSamples = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ScratchArena)
+};
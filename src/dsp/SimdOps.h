@@ -0,0 +1,71 @@
+#pragma once
+
+#if defined(__AVX__)
+ #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+ #include <emmintrin.h>
+#endif
+
+/**
+ * @brief Минимальная обертка над SSE/AVX для векторных ядер DSP
+ *
+ * Ширина регистра выбирается при компиляции: AVX (8 float), SSE2 (4 float)
+ * или скалярный fallback (1 float) для остальных платформ. Загрузки и
+ * сохранения требуют выравнивания по ширине регистра.
+ */
+namespace SimdOps
+{
+#if defined(__AVX__)
+    using Vec = __m256;
+    constexpr int width = 8;
+
+    inline Vec load(const float* p)          { return _mm256_load_ps(p); }
+    inline Vec loadUnaligned(const float* p) { return _mm256_loadu_ps(p); }
+    inline void store(float* p, Vec v)       { _mm256_store_ps(p, v); }
+    inline void storeUnaligned(float* p, Vec v) { _mm256_storeu_ps(p, v); }
+    inline Vec broadcast(float x)            { return _mm256_set1_ps(x); }
+    inline Vec add(Vec a, Vec b)             { return _mm256_add_ps(a, b); }
+    inline Vec sub(Vec a, Vec b)             { return _mm256_sub_ps(a, b); }
+    inline Vec mul(Vec a, Vec b)             { return _mm256_mul_ps(a, b); }
+
+    inline float sum(Vec v)
+    {
+        __m128 lo = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+        lo = _mm_add_ss(lo, _mm_shuffle_ps(lo, lo, 0x55));
+        return _mm_cvtss_f32(lo);
+    }
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+    using Vec = __m128;
+    constexpr int width = 4;
+
+    inline Vec load(const float* p)          { return _mm_load_ps(p); }
+    inline Vec loadUnaligned(const float* p) { return _mm_loadu_ps(p); }
+    inline void store(float* p, Vec v)       { _mm_store_ps(p, v); }
+    inline void storeUnaligned(float* p, Vec v) { _mm_storeu_ps(p, v); }
+    inline Vec broadcast(float x)            { return _mm_set1_ps(x); }
+    inline Vec add(Vec a, Vec b)             { return _mm_add_ps(a, b); }
+    inline Vec sub(Vec a, Vec b)             { return _mm_sub_ps(a, b); }
+    inline Vec mul(Vec a, Vec b)             { return _mm_mul_ps(a, b); }
+
+    inline float sum(Vec v)
+    {
+        v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+        v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 0x55));
+        return _mm_cvtss_f32(v);
+    }
+#else
+    using Vec = float;
+    constexpr int width = 1;
+
+    inline Vec load(const float* p)          { return *p; }
+    inline Vec loadUnaligned(const float* p) { return *p; }
+    inline void store(float* p, Vec v)       { *p = v; }
+    inline void storeUnaligned(float* p, Vec v) { *p = v; }
+    inline Vec broadcast(float x)            { return x; }
+    inline Vec add(Vec a, Vec b)             { return a + b; }
+    inline Vec sub(Vec a, Vec b)             { return a - b; }
+    inline Vec mul(Vec a, Vec b)             { return a * b; }
+    inline float sum(Vec v)                  { return v; }
+#endif
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Lock-free тройной буфер для передачи снимков между двумя потоками
+ *
+ * Один поток-производитель (обычно message thread) заполняет свой буфер
+ * и публикует его, другой поток-потребитель (аудио-поток) в начале блока
+ * забирает самый свежий опубликованный снимок. Три слота обмениваются
+ * одним атомарным индексом: ни блокировок, ни аллокаций, потребитель
+ * никогда не видит наполовину записанный снимок, а промежуточные
+ * публикации просто перезаписываются.
+ *
+ * T должен быть копируемым значением фиксированного размера.
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+    //==============================================================================
+    TripleBuffer() = default;
+
+    //==============================================================================
+    // Производитель: буфер для заполнения. После publish() слот сменится,
+    // его содержимое - снимок двухшаговой давности, поэтому заполнять полностью
+    T& getWriteBuffer() noexcept { return buffers[backIndex]; }
+
+    void publish() noexcept
+    {
+        const auto previous = middle.exchange(static_cast<std::uint8_t>(backIndex | newDataFlag),
+                                              std::memory_order_acq_rel);
+        backIndex = previous & indexMask;
+    }
+
+    //==============================================================================
+    // Потребитель: забирает последний опубликованный снимок, если он новый
+    bool acquire() noexcept
+    {
+        if ((middle.load(std::memory_order_relaxed) & newDataFlag) == 0)
+            return false;
+
+        const auto previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+        frontIndex = previous & indexMask;
+        return true;
+    }
+
+    const T& read() const noexcept { return buffers[frontIndex]; }
+
+private:
+    //==============================================================================
+    static constexpr std::uint8_t indexMask = 0x3;
+    static constexpr std::uint8_t newDataFlag = 0x4;
+
+    std::array<T, 3> buffers {};
+    std::atomic<std::uint8_t> middle { 1 };
+    std::uint8_t backIndex = 2;     // Только производитель
+    std::uint8_t frontIndex = 0;    // Только потребитель
+
+    JUCE_DECLARE_NON_COPYABLE(TripleBuffer)
+};